@@ -0,0 +1,335 @@
+#include "compiler.h"
+#include "corpus.h"
+#include "optimizer.h"
+#include "output.h"
+#include "parser.h"
+#include "resolver.h"
+#include "scanner.h"
+#include "stats.h"
+#include "vm.h"
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <fcntl.h>
+#include <functional>
+#include <iostream>
+#include <string>
+#include <string_view>
+#include <unistd.h>
+#include <vector>
+
+// per-phase micro-benchmarks over generated corpora. every phase is timed
+// on its own with the earlier phases done up front, and reported as the
+// median of the iterations together with ns/token and ns/node so corpora of
+// different sizes stay comparable. builds with LOX_TRACK_ALLOCATIONS also
+// report the allocations of one call of each phase
+
+namespace {
+using lox::bench::CorpusInfo;
+
+struct Options
+{
+    std::string format     = "json";
+    size_t      size       = 1 << 20;
+    int         iterations = 10;
+    uint64_t    seed       = lox::bench::DEFAULT_SEED;
+    std::string corpus;
+    std::string phase;
+    std::string dump;
+};
+
+struct Result
+{
+    std::string_view corpus;
+    std::string_view phase;
+    size_t           bytes;
+    size_t           tokens;
+    size_t           nodes;
+    int              iterations;
+    double           ns;
+    size_t           allocations;
+    size_t           allocated_bytes;
+};
+
+struct Measurement
+{
+    double ns;
+    size_t allocations;
+    size_t allocated_bytes;
+};
+
+// everything a phase may need, built once per corpus
+struct Fixture
+{
+    std::string                   source;
+    std::vector<lox::Token>       tokens;
+    lox::Arena                    arena;
+    lox::Heap                     heap;
+    std::vector<lox::Statement *> program;
+    size_t                        nodes = 0;
+    lox::Resolver                 resolver;
+    lox::Chunk                    chunk;
+};
+
+// program output goes to /dev/null through the same buffer the interpreter uses
+struct NullOutput
+{
+    NullOutput() : fd(open("/dev/null", O_WRONLY)), buffer(fd), out(&buffer) {}
+    ~NullOutput()
+    {
+        out.flush();
+        close(fd);
+    }
+
+    int               fd;
+    lox::OutputBuffer buffer;
+    std::ostream      out;
+};
+
+[[noreturn]] void fail(std::string_view message)
+{
+    std::cerr << "lox_bench: " << message << std::endl;
+    std::exit(1);
+}
+
+void prepare(Fixture &fixture, lox::Diagnostics &diagnostics)
+{
+    {
+        lox::Scanner scanner(fixture.source, diagnostics);
+        fixture.tokens = scanner.get_tokens();
+    }
+    lox::Parser parser(fixture.tokens, fixture.arena, fixture.heap, diagnostics);
+    parser.parse_program(fixture.program);
+    fixture.nodes = fixture.arena.objects_allocated();
+
+    // the program is left unfolded, so evaluate, compile and vm walk the
+    // `nodes` they are reported per; folding shows in optimize and run only
+    for(auto statement: fixture.program)
+    {
+        fixture.resolver.resolve(statement);
+    }
+    lox::Compiler compiler(fixture.chunk, diagnostics);
+    compiler.compile_program(fixture.program);
+    if(diagnostics.had_error())
+    {
+        fail("generated corpus does not compile");
+    }
+}
+
+// `setup` runs before every timed call of `body` and is not counted;
+// allocations are counted over the warm-up call
+Measurement measure_median(int iterations, const std::function<void()> &setup, const std::function<void()> &body)
+{
+    setup();
+    lox::AllocationCounts before = lox::allocation_totals();
+    body(); // warm-up
+    lox::AllocationCounts after = lox::allocation_totals();
+    std::vector<double> samples;
+    for(int i = 0; i < iterations; i++)
+    {
+        setup();
+        auto start = std::chrono::steady_clock::now();
+        body();
+        auto end = std::chrono::steady_clock::now();
+        samples.push_back(std::chrono::duration<double, std::nano>(end - start).count());
+    }
+    std::sort(samples.begin(), samples.end());
+    return {samples[samples.size() / 2], after.count - before.count, after.bytes - before.bytes};
+}
+
+void run_corpus(const CorpusInfo &info, const Options &options, std::vector<Result> &results)
+{
+    lox::Diagnostics diagnostics;
+    Fixture          fixture;
+    fixture.source = lox::bench::generate_corpus(info.kind, options.size, options.seed);
+    prepare(fixture, diagnostics);
+
+    NullOutput null;
+    auto       measure = [&](std::string_view phase, const std::function<void()> &body,
+                       const std::function<void()> &setup = [] {}) {
+        if(!options.phase.empty() && options.phase != phase) return;
+        Measurement m = measure_median(options.iterations, setup, body);
+        results.push_back({info.name, phase, fixture.source.size(), fixture.tokens.size(), fixture.nodes,
+                           options.iterations, m.ns, m.allocations, m.allocated_bytes});
+    };
+
+    measure("scan", [&] {
+        lox::Scanner scanner(fixture.source, diagnostics);
+        scanner.get_tokens();
+    });
+    measure("parse", [&] {
+        lox::Arena                    arena;
+        std::vector<lox::Statement *> program;
+        lox::Parser                   parser(fixture.tokens, arena, fixture.heap, diagnostics);
+        parser.parse_program(program);
+    });
+    // folding rewrites the tree, so every iteration optimizes a fresh parse
+    lox::Arena                    scratch;
+    std::vector<lox::Statement *> unoptimized;
+    measure(
+        "optimize",
+        [&] {
+            lox::Optimizer optimizer(scratch, fixture.heap);
+            for(auto statement: unoptimized)
+            {
+                optimizer.optimize(statement);
+            }
+        },
+        [&] {
+            scratch.reset();
+            unoptimized.clear();
+            lox::Parser parser(fixture.tokens, scratch, fixture.heap, diagnostics);
+            parser.parse_program(unoptimized);
+        });
+    measure("evaluate", [&] {
+        lox::Globals globals;
+        globals.reserve(fixture.resolver.slot_count());
+        for(auto statement: fixture.program)
+        {
+            statement->execute(fixture.heap, globals, null.out);
+        }
+    });
+    measure("compile", [&] {
+        lox::Chunk    chunk;
+        lox::Compiler compiler(chunk, diagnostics);
+        compiler.compile_program(fixture.program);
+    });
+    measure("vm", [&] {
+        lox::VM vm(fixture.heap, diagnostics, null.out);
+        vm.run(fixture.chunk);
+    });
+    measure("run", [&] {
+        lox::Arena                    arena;
+        lox::Heap                     heap;
+        std::vector<lox::Statement *> program;
+        lox::Scanner                  scanner(fixture.source, diagnostics);
+        lox::Parser                   parser(scanner, arena, heap, diagnostics);
+        parser.parse_program(program);
+        lox::Optimizer optimizer(arena, heap);
+        lox::Resolver  resolver;
+        for(auto statement: program)
+        {
+            optimizer.optimize(statement);
+            resolver.resolve(statement);
+        }
+        lox::Globals globals;
+        globals.reserve(resolver.slot_count());
+        for(auto statement: program)
+        {
+            statement->execute(heap, globals, null.out);
+        }
+    });
+
+    if(diagnostics.exit_code() != 0)
+    {
+        fail("benchmark reported errors");
+    }
+}
+
+double per(double ns, size_t count)
+{
+    return count ? ns / count : 0.0;
+}
+
+void print_json(const std::vector<Result> &results, const Options &options)
+{
+    std::cout << "{\n  \"seed\": " << options.seed << ",\n  \"benchmarks\": [\n";
+    for(size_t i = 0; i < results.size(); i++)
+    {
+        const Result &r = results[i];
+        std::cout << "    {\"corpus\": \"" << r.corpus << "\", \"phase\": \"" << r.phase << "\", \"bytes\": " << r.bytes
+                  << ", \"tokens\": " << r.tokens << ", \"nodes\": " << r.nodes << ", \"iterations\": " << r.iterations
+                  << ", \"ns\": " << r.ns << ", \"ns_per_token\": " << per(r.ns, r.tokens)
+                  << ", \"ns_per_node\": " << per(r.ns, r.nodes);
+        if(lox::TRACK_ALLOCATIONS)
+        {
+            std::cout << ", \"allocations\": " << r.allocations << ", \"allocated_bytes\": " << r.allocated_bytes;
+        }
+        std::cout << "}" << (i + 1 < results.size() ? "," : "") << "\n";
+    }
+    std::cout << "  ]\n}\n";
+}
+
+void print_csv(const std::vector<Result> &results)
+{
+    std::cout << "corpus,phase,bytes,tokens,nodes,iterations,ns,ns_per_token,ns_per_node"
+              << (lox::TRACK_ALLOCATIONS ? ",allocations,allocated_bytes\n" : "\n");
+    for(const Result &r: results)
+    {
+        std::cout << r.corpus << ',' << r.phase << ',' << r.bytes << ',' << r.tokens << ',' << r.nodes << ','
+                  << r.iterations << ',' << r.ns << ',' << per(r.ns, r.tokens) << ',' << per(r.ns, r.nodes);
+        if(lox::TRACK_ALLOCATIONS)
+        {
+            std::cout << ',' << r.allocations << ',' << r.allocated_bytes;
+        }
+        std::cout << '\n';
+    }
+}
+
+Options parse_options(int argc, char *argv[])
+{
+    Options options;
+    for(int i = 1; i < argc; i++)
+    {
+        std::string_view arg = argv[i];
+        auto             value = [&](std::string_view prefix) -> std::string_view {
+            return arg.starts_with(prefix) ? arg.substr(prefix.size()) : std::string_view();
+        };
+        if(auto v = value("--format="); !v.empty())
+            options.format = v;
+        else if(auto v = value("--size="); !v.empty())
+            options.size = std::stoull(std::string(v));
+        else if(auto v = value("--iterations="); !v.empty())
+            options.iterations = std::max(1, std::stoi(std::string(v)));
+        else if(auto v = value("--seed="); !v.empty())
+            options.seed = std::stoull(std::string(v));
+        else if(auto v = value("--corpus="); !v.empty())
+            options.corpus = v;
+        else if(auto v = value("--phase="); !v.empty())
+            options.phase = v;
+        else if(auto v = value("--dump="); !v.empty())
+            options.dump = v;
+        else
+            fail("usage: lox_bench [--format=json|csv] [--size=BYTES] [--iterations=N] [--seed=N] "
+                 "[--corpus=NAME] [--phase=NAME] [--dump=CORPUS]");
+    }
+    if(options.format != "json" && options.format != "csv")
+    {
+        fail("--format must be json or csv");
+    }
+    return options;
+}
+} // namespace
+
+int main(int argc, char *argv[])
+{
+    Options options = parse_options(argc, argv);
+
+    if(!options.dump.empty())
+    {
+        for(const CorpusInfo &info: lox::bench::CORPORA)
+        {
+            if(info.name == options.dump)
+            {
+                std::cout << lox::bench::generate_corpus(info.kind, options.size, options.seed);
+                return 0;
+            }
+        }
+        fail("unknown corpus: " + options.dump);
+    }
+
+    std::vector<Result> results;
+    for(const CorpusInfo &info: lox::bench::CORPORA)
+    {
+        if(options.corpus.empty() || options.corpus == info.name)
+        {
+            run_corpus(info, options, results);
+        }
+    }
+
+    if(options.format == "json")
+        print_json(results, options);
+    else
+        print_csv(results);
+    return 0;
+}
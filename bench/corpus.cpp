@@ -0,0 +1,185 @@
+#include "corpus.h"
+
+namespace lox::bench {
+namespace {
+// splitmix64: fully specified, unlike the std distributions, so corpora are
+// identical across standard libraries
+class Random
+{
+  public:
+    explicit Random(uint64_t seed) : state(seed) {}
+
+    uint64_t next()
+    {
+        uint64_t z = (state += 0x9e3779b97f4a7c15);
+        z          = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9;
+        z          = (z ^ (z >> 27)) * 0x94d049bb133111eb;
+        return z ^ (z >> 31);
+    }
+    // uniform enough in [0, bound) for corpus generation
+    size_t below(size_t bound)
+    {
+        return next() % bound;
+    }
+
+  private:
+    uint64_t state;
+};
+
+constexpr size_t VARIABLES = 64;
+
+void number(std::string &out, Random &random)
+{
+    out += std::to_string(1 + random.below(999));
+    if(random.below(4) == 0)
+    {
+        out += '.';
+        out += std::to_string(random.below(100));
+    }
+}
+
+// + - * / with a non-zero number literal on the right of every division
+void arithmetic_operator(std::string &out, Random &random)
+{
+    static constexpr std::string_view OPERATORS[] = {" + ", " - ", " * ", " / "};
+    out += OPERATORS[random.below(4)];
+}
+
+void arithmetic(std::string &out, Random &random)
+{
+    out += "print ";
+    number(out, random);
+    for(int i = 0; i < 48; i++)
+    {
+        arithmetic_operator(out, random);
+        number(out, random);
+    }
+    out += ";\n";
+}
+
+void nested(std::string &out, Random &random)
+{
+    constexpr int DEPTH = 48;
+    out += "print ";
+    out.append(DEPTH, '(');
+    number(out, random);
+    for(int i = 0; i < DEPTH; i++)
+    {
+        arithmetic_operator(out, random);
+        if(random.below(3) == 0)
+        {
+            out += "-";
+        }
+        number(out, random);
+        out += ')';
+    }
+    out += ";\n";
+}
+
+std::string variable_name(size_t index)
+{
+    return "counter_value_" + std::to_string(index);
+}
+
+void identifiers(std::string &out, Random &random)
+{
+    out += variable_name(random.below(VARIABLES));
+    out += " = ";
+    out += variable_name(random.below(VARIABLES));
+    for(int i = 0; i < 8; i++)
+    {
+        out += random.below(2) ? " + " : " - ";
+        out += variable_name(random.below(VARIABLES));
+    }
+    out += " * 0.5;\n";
+}
+
+constexpr std::string_view WORDS[] = {"alpha", "beta", "gamma", "delta", "epsilon", "zeta", "eta", "theta"};
+
+void string_literal(std::string &out, Random &random)
+{
+    out += '"';
+    out += WORDS[random.below(std::size(WORDS))];
+    out += ' ';
+    out += WORDS[random.below(std::size(WORDS))];
+    out += '"';
+}
+
+void strings(std::string &out, Random &random)
+{
+    out += "print ";
+    string_literal(out, random);
+    out += " + text_";
+    out += std::to_string(random.below(8));
+    out += " + ";
+    string_literal(out, random);
+    out += random.below(2) ? " == " : " != ";
+    string_literal(out, random);
+    out += ";\n";
+}
+
+void statements(std::string &out, Random &random)
+{
+    // appended piece by piece: GCC's -Wrestrict misfires on chains of
+    // std::string operator+ at -O2
+    std::string name = "v";
+    name.append(std::to_string(random.below(VARIABLES)));
+    switch(random.below(4))
+    {
+    case 0:
+        out.append("var ").append(name).append(" = ").append(std::to_string(random.below(100))).append(";\n");
+        break;
+    case 1:  out.append(name).append(" = ").append(name).append(" + 1;\n"); break;
+    case 2:  out.append("print ").append(name).append(";\n"); break;
+    default: out.append("print !true == false;\n"); break;
+    }
+}
+} // namespace
+
+std::string generate_corpus(CorpusKind kind, size_t target_bytes, uint64_t seed)
+{
+    Random      random(seed);
+    std::string out;
+    out.reserve(target_bytes + 1024);
+
+    // declarations every statement of the corpus may rely on
+    switch(kind)
+    {
+    case CorpusKind::IDENTIFIERS:
+        for(size_t i = 0; i < VARIABLES; i++)
+        {
+            out += "var " + variable_name(i) + " = " + std::to_string(i) + ";\n";
+        }
+        break;
+    case CorpusKind::STRINGS:
+        for(int i = 0; i < 8; i++)
+        {
+            out += "var text_" + std::to_string(i) + " = ";
+            string_literal(out, random);
+            out += ";\n";
+        }
+        break;
+    case CorpusKind::STATEMENTS:
+        for(size_t i = 0; i < VARIABLES; i++)
+        {
+            out += "var v" + std::to_string(i) + " = 0;\n";
+        }
+        break;
+    default:
+        break;
+    }
+
+    while(out.size() < target_bytes)
+    {
+        switch(kind)
+        {
+        case CorpusKind::ARITHMETIC:  arithmetic(out, random); break;
+        case CorpusKind::NESTED:      nested(out, random); break;
+        case CorpusKind::IDENTIFIERS: identifiers(out, random); break;
+        case CorpusKind::STRINGS:     strings(out, random); break;
+        case CorpusKind::STATEMENTS:  statements(out, random); break;
+        }
+    }
+    return out;
+}
+} // namespace lox::bench
@@ -0,0 +1,42 @@
+#ifndef CORPUS_H
+#define CORPUS_H
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+
+namespace lox::bench {
+enum class CorpusKind
+{
+    ARITHMETIC,  // long chains of binary operators over number literals
+    NESTED,      // deeply nested groupings
+    IDENTIFIERS, // many variables read and assigned in expressions
+    STRINGS,     // string literals, concatenation and comparison
+    STATEMENTS   // many short declarations, assignments and prints
+};
+
+struct CorpusInfo
+{
+    CorpusKind       kind;
+    std::string_view name;
+};
+
+constexpr std::array<CorpusInfo, 5> CORPORA = {{
+    {CorpusKind::ARITHMETIC, "arithmetic"},
+    {CorpusKind::NESTED, "nested"},
+    {CorpusKind::IDENTIFIERS, "identifiers"},
+    {CorpusKind::STRINGS, "strings"},
+    {CorpusKind::STATEMENTS, "statements"},
+}};
+
+constexpr uint64_t DEFAULT_SEED = 0x10c5eed;
+
+// generates a valid program of roughly `target_bytes` that runs without
+// errors. the output depends only on the arguments, so the same corpus can
+// be regenerated on any machine to compare results over time
+std::string generate_corpus(CorpusKind kind, size_t target_bytes, uint64_t seed = DEFAULT_SEED);
+} // namespace lox::bench
+
+#endif // CORPUS_H
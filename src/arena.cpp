@@ -0,0 +1,67 @@
+#include "arena.h"
+#include <algorithm>
+#include <cstdint>
+
+namespace lox {
+Arena::~Arena()
+{
+    run_destructors();
+}
+
+void Arena::reset()
+{
+    run_destructors();
+    if(blocks.size() > 1)
+    {
+        blocks.erase(blocks.begin() + 1, blocks.end());
+    }
+    cursor  = blocks.empty() ? nullptr : blocks[0].data.get();
+    limit   = blocks.empty() ? nullptr : cursor + blocks[0].size;
+    objects = 0;
+}
+
+size_t Arena::objects_allocated() const
+{
+    return objects;
+}
+
+size_t Arena::bytes_reserved() const
+{
+    size_t bytes = destructors.capacity() * sizeof(Destructor);
+    for(const Block &block: blocks)
+    {
+        bytes += block.size;
+    }
+    return bytes;
+}
+
+void *Arena::allocate(size_t size, size_t align)
+{
+    auto aligned = [&](char *p) {
+        return reinterpret_cast<char *>((reinterpret_cast<uintptr_t>(p) + align - 1) & ~(uintptr_t(align) - 1));
+    };
+    char *start = cursor ? aligned(cursor) : nullptr;
+    if(!start || start + size > limit)
+    {
+        // blocks double in size so a large parse needs only a logarithmic
+        // number of trips to the system allocator
+        size_t block_size = blocks.empty() ? FIRST_BLOCK_SIZE : blocks.back().size * 2;
+        block_size        = std::max(block_size, size + align);
+        blocks.push_back({std::make_unique_for_overwrite<char[]>(block_size), block_size});
+        cursor = blocks.back().data.get();
+        limit  = cursor + block_size;
+        start  = aligned(cursor);
+    }
+    cursor = start + size;
+    return start;
+}
+
+void Arena::run_destructors()
+{
+    for(auto it = destructors.rbegin(); it != destructors.rend(); ++it)
+    {
+        it->destroy(it->object);
+    }
+    destructors.clear();
+}
+} // namespace lox
@@ -0,0 +1,67 @@
+#ifndef ARENA_H
+#define ARENA_H
+
+#include <cstddef>
+#include <memory>
+#include <new>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+namespace lox {
+// bump allocator owning every AST node of a parse. nodes are never freed
+// individually: reset() or destruction releases all of them at once, running
+// destructors only for the node types that need one
+class Arena
+{
+  public:
+    Arena() = default;
+    Arena(const Arena &)            = delete;
+    Arena &operator=(const Arena &) = delete;
+    ~Arena();
+
+    template <typename T, typename... Args> T *make(Args &&...args)
+    {
+        T *object = new(allocate(sizeof(T), alignof(T))) T(std::forward<Args>(args)...);
+        objects++;
+        if constexpr(!std::is_trivially_destructible_v<T>)
+        {
+            destructors.push_back({[](void *p) { static_cast<T *>(p)->~T(); }, object});
+        }
+        return object;
+    }
+
+    // raw storage with the arena's lifetime, e.g. for string characters
+    void  *allocate(size_t size, size_t align);
+    // destroys every object but keeps the first block for reuse
+    void   reset();
+    // objects created with make() since construction or the last reset()
+    size_t objects_allocated() const;
+    // bytes of the blocks held, used or not
+    size_t bytes_reserved() const;
+
+  private:
+    void run_destructors();
+
+    struct Block
+    {
+        std::unique_ptr<char[]> data;
+        size_t                  size;
+    };
+    struct Destructor
+    {
+        void (*destroy)(void *);
+        void *object;
+    };
+
+    static constexpr size_t FIRST_BLOCK_SIZE = 4096;
+
+    std::vector<Block>      blocks;
+    std::vector<Destructor> destructors;
+    char                   *cursor  = nullptr;
+    char                   *limit   = nullptr;
+    size_t                  objects = 0;
+};
+} // namespace lox
+
+#endif // ARENA_H
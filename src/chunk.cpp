@@ -0,0 +1,48 @@
+#include "chunk.h"
+#include <algorithm>
+
+namespace lox {
+void Chunk::write(uint8_t byte, int line)
+{
+    if(lines.empty() || lines.back().line != line)
+    {
+        lines.push_back({code.size(), line});
+    }
+    code.push_back(byte);
+}
+
+void Chunk::write_operand(size_t index, int line)
+{
+    for(size_t i = 0; i < OPERAND_SIZE; i++)
+    {
+        write(static_cast<uint8_t>(index >> (8 * i)), line);
+    }
+}
+
+size_t Chunk::read_operand(size_t offset) const
+{
+    size_t index = 0;
+    for(size_t i = 0; i < OPERAND_SIZE; i++)
+    {
+        index |= static_cast<size_t>(code[offset + i]) << (8 * i);
+    }
+    return index;
+}
+
+size_t Chunk::add_constant(Value value)
+{
+    constants.push_back(value);
+    return constants.size() - 1;
+}
+
+int Chunk::get_line(size_t offset) const
+{
+    auto it = std::upper_bound(lines.begin(), lines.end(), offset,
+                               [](size_t off, const LineStart &start) { return off < start.offset; });
+    if(it == lines.begin())
+    {
+        return 0;
+    }
+    return std::prev(it)->line;
+}
+} // namespace lox
@@ -0,0 +1,68 @@
+#ifndef CHUNK_H
+#define CHUNK_H
+
+#include "value.h"
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace lox {
+enum OpCode : uint8_t
+{
+    OP_CONSTANT,
+    OP_NIL,
+    OP_TRUE,
+    OP_FALSE,
+    OP_POP,
+    OP_GET_GLOBAL,
+    OP_DEFINE_GLOBAL,
+    OP_SET_GLOBAL,
+    OP_EQUAL,
+    OP_NOT_EQUAL,
+    OP_GREATER,
+    OP_GREATER_EQUAL,
+    OP_LESS,
+    OP_LESS_EQUAL,
+    OP_ADD,
+    OP_SUBTRACT,
+    OP_MULTIPLY,
+    OP_DIVIDE,
+    OP_NOT,
+    OP_NEGATE,
+    OP_PRINT,
+    OP_RETURN
+};
+
+// a compiled program: opcodes with inline operands, the constant pool they
+// index into and a run-length encoded table mapping code offsets to lines.
+// operands are 24-bit little-endian indices into the constant pool or, for
+// the global opcodes, into the global slots named by `globals`
+class Chunk
+{
+  public:
+    void   write(uint8_t byte, int line);
+    void   write_operand(size_t index, int line);
+    size_t read_operand(size_t offset) const;
+    size_t add_constant(Value value);
+    int    get_line(size_t offset) const;
+
+    static constexpr size_t OPERAND_SIZE = 3;
+    static constexpr size_t MAX_CONSTANTS = size_t(1) << 24;
+
+    std::vector<uint8_t>           code;
+    std::vector<Value>             constants;
+    std::vector<const ObjString *> globals;
+    // code offset just past each top-level statement, in program order
+    std::vector<size_t>            statement_ends;
+
+    // the line of every offset from `offset` up to the next entry's
+    struct LineStart
+    {
+        size_t offset;
+        int    line;
+    };
+    std::vector<LineStart>         lines;
+};
+} // namespace lox
+
+#endif // CHUNK_H
@@ -0,0 +1,152 @@
+#include "compiler.h"
+
+namespace lox {
+bool Compiler::compile_expression(const Expression *expr, bool print)
+{
+    if(!expr)
+    {
+        error("Expect expression.");
+        return false;
+    }
+    expression(*expr);
+    if(print)
+    {
+        emit(OP_PRINT);
+    }
+    finish();
+    return !had_error;
+}
+
+bool Compiler::compile_program(const std::vector<Statement *> &statements)
+{
+    for(const Statement *statement: statements)
+    {
+        this->statement(*statement);
+        chunk.statement_ends.push_back(chunk.code.size());
+    }
+    finish();
+    return !had_error;
+}
+
+void Compiler::statement(const Statement &statement)
+{
+    line = statement.line;
+    if(auto print = dynamic_cast<const PrintStatement *>(&statement))
+    {
+        expression(*print->expression);
+        emit(OP_PRINT);
+    }
+    else if(auto var = dynamic_cast<const VarStatement *>(&statement))
+    {
+        if(var->initializer)
+        {
+            expression(*var->initializer);
+        }
+        else
+        {
+            emit(OP_NIL);
+        }
+        line = var->line;
+        emit_with_operand(OP_DEFINE_GLOBAL, resolver.declare(var->symbol));
+    }
+    else if(auto expr = dynamic_cast<const ExpressionStatement *>(&statement))
+    {
+        expression(*expr->expression);
+        emit(OP_POP);
+    }
+}
+
+void Compiler::expression(const Expression &expr)
+{
+    if(auto binary = dynamic_cast<const Binary *>(&expr))
+    {
+        expression(*binary->left);
+        expression(*binary->right);
+        line = binary->line;
+        switch(binary->op)
+        {
+        case TokenType::EQUAL_EQUAL:   emit(OP_EQUAL); break;
+        case TokenType::BANG_EQUAL:    emit(OP_NOT_EQUAL); break;
+        case TokenType::GREATER:       emit(OP_GREATER); break;
+        case TokenType::GREATER_EQUAL: emit(OP_GREATER_EQUAL); break;
+        case TokenType::LESS:          emit(OP_LESS); break;
+        case TokenType::LESS_EQUAL:    emit(OP_LESS_EQUAL); break;
+        case TokenType::PLUS:          emit(OP_ADD); break;
+        case TokenType::MINUS:         emit(OP_SUBTRACT); break;
+        case TokenType::STAR:          emit(OP_MULTIPLY); break;
+        case TokenType::SLASH:         emit(OP_DIVIDE); break;
+        default:                       error("Unsupported binary operator."); break;
+        }
+    }
+    else if(auto unary = dynamic_cast<const Unary *>(&expr))
+    {
+        expression(*unary->right);
+        line = unary->line;
+        emit(unary->op == TokenType::MINUS ? OP_NEGATE : OP_NOT);
+    }
+    else if(auto grouping = dynamic_cast<const Grouping *>(&expr))
+    {
+        expression(*grouping->expression);
+    }
+    else if(auto variable = dynamic_cast<const Variable *>(&expr))
+    {
+        line = variable->name.line;
+        emit_with_operand(OP_GET_GLOBAL, resolver.declare(variable->symbol));
+    }
+    else if(auto assign = dynamic_cast<const Assign *>(&expr))
+    {
+        expression(*assign->value);
+        line = assign->name.line;
+        emit_with_operand(OP_SET_GLOBAL, resolver.declare(assign->symbol));
+    }
+    else if(auto literal = dynamic_cast<const Literal *>(&expr))
+    {
+        Value value = literal->value;
+        if(value.is_nil())
+        {
+            emit(OP_NIL);
+        }
+        else if(value.is_bool())
+        {
+            emit(value.as_bool() ? OP_TRUE : OP_FALSE);
+        }
+        else
+        {
+            emit_constant(value);
+        }
+    }
+}
+
+void Compiler::emit(uint8_t byte)
+{
+    chunk.write(byte, line);
+}
+
+void Compiler::emit_constant(Value value)
+{
+    emit_with_operand(OP_CONSTANT, chunk.add_constant(value));
+}
+
+void Compiler::emit_with_operand(OpCode op, size_t index)
+{
+    if(index >= Chunk::MAX_CONSTANTS)
+    {
+        error("Too many constants in one chunk.");
+        return;
+    }
+    emit(op);
+    chunk.write_operand(index, line);
+}
+
+void Compiler::finish()
+{
+    emit(OP_RETURN);
+    chunk.globals = resolver.names();
+}
+
+void Compiler::error(const std::string &message)
+{
+    diagnostics.error(line, "", message);
+    had_error = true;
+}
+} // namespace lox
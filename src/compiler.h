@@ -0,0 +1,51 @@
+#ifndef COMPILER_H
+#define COMPILER_H
+
+#include "chunk.h"
+#include "diagnostics.h"
+#include "parser.h"
+#include "resolver.h"
+#include <string>
+#include <vector>
+
+namespace lox {
+// lowers parsed expressions and statements into a Chunk for the VM
+class Compiler
+{
+  public:
+    // string constants and global names are referenced, not copied: the
+    // Heap the program was parsed with must outlive the chunk
+    Compiler(Chunk &chunk, Diagnostics &diagnostics) : chunk(chunk), diagnostics(diagnostics), resolver(own_resolver)
+    {
+    }
+    // global slots come from `resolver`, which outlives the compiler, so
+    // programs compiled one after another agree on them
+    Compiler(Chunk &chunk, Diagnostics &diagnostics, Resolver &resolver)
+        : chunk(chunk), diagnostics(diagnostics), resolver(resolver)
+    {
+    }
+
+    // compiles a single expression whose value is printed, as `evaluate`
+    // does, or with `print` false left for VM::result()
+    bool compile_expression(const Expression *expr, bool print = true);
+    bool compile_program(const std::vector<Statement *> &statements);
+
+  private:
+    void statement(const Statement &statement);
+    void expression(const Expression &expr);
+    void emit(uint8_t byte);
+    void emit_constant(Value value);
+    void emit_with_operand(OpCode op, size_t index);
+    void finish();
+    void error(const std::string &message);
+
+    Chunk       &chunk;
+    Diagnostics &diagnostics;
+    Resolver     own_resolver;
+    Resolver    &resolver;
+    int          line      = 1;
+    bool         had_error = false;
+};
+} // namespace lox
+
+#endif // COMPILER_H
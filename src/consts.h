@@ -1,8 +1,8 @@
 #ifndef CONSTS_H
 #define CONSTS_H
 
-#include <map>
-#include <string>
+#include <cstddef>
+#include <string_view>
 
 namespace lox {
 enum TokenType
@@ -49,45 +49,178 @@ enum TokenType
     END_OF_FILE
 };
 
-// token type and identifier
-const std::map<TokenType, std::pair<std::string, std::string>> tokenident = {
-    {TokenType::LEFT_PAREN,         {"LEFT_PAREN",      "("}},
-    {TokenType::RIGHT_PAREN,        {"RIGHT_PAREN",     ")"}},
-    {TokenType::LEFT_BRACE,         {"LEFT_BRACE",      "{"}},
-    {TokenType::RIGHT_BRACE,        {"RIGHT_BRACE",     "}"}},
-    {TokenType::COMMA,              {"COMMA",           ","}},
-    {TokenType::DOT,                {"DOT",             "."}},
-    {TokenType::MINUS,              {"MINUS",           "-"}},
-    {TokenType::PLUS,               {"PLUS",            "+"}},
-    {TokenType::SEMICOLON,          {"SEMICOLON",       ";"}},
-    {TokenType::SLASH,              {"SLASH",           "/"}},
-    {TokenType::STAR,               {"STAR",            "*"}},
-    {TokenType::EQUAL,              {"EQUAL",           "="}},
-    {TokenType::BANG,               {"BANG",            "!"}},
-    {TokenType::LESS,               {"LESS",            "<"}},
-    {TokenType::GREATER,            {"GREATER",         ">"}},
-    {TokenType::EQUAL_EQUAL,        {"EQUAL_EQUAL",     "=="}},
-    {TokenType::BANG_EQUAL,         {"BANG_EQUAL",      "!="}},
-    {TokenType::LESS_EQUAL,         {"LESS_EQUAL",      "<="}},
-    {TokenType::GREATER_EQUAL,      {"GREATER_EQUAL",   ">="}},
-    {TokenType::END_OF_FILE,        {"EOF",             ""}}};
+// true for the single and two character operators and EOF, which tokenize
+// prints as "NAME symbol null"
+constexpr bool is_symbol_token(TokenType type)
+{
+    return type <= TokenType::GREATER_EQUAL || type == TokenType::END_OF_FILE;
+}
+
+constexpr std::string_view token_name(TokenType type)
+{
+    switch(type)
+    {
+    case TokenType::LEFT_PAREN:    return "LEFT_PAREN";
+    case TokenType::RIGHT_PAREN:   return "RIGHT_PAREN";
+    case TokenType::LEFT_BRACE:    return "LEFT_BRACE";
+    case TokenType::RIGHT_BRACE:   return "RIGHT_BRACE";
+    case TokenType::COMMA:         return "COMMA";
+    case TokenType::DOT:           return "DOT";
+    case TokenType::MINUS:         return "MINUS";
+    case TokenType::PLUS:          return "PLUS";
+    case TokenType::SEMICOLON:     return "SEMICOLON";
+    case TokenType::SLASH:         return "SLASH";
+    case TokenType::STAR:          return "STAR";
+    case TokenType::EQUAL:         return "EQUAL";
+    case TokenType::BANG:          return "BANG";
+    case TokenType::LESS:          return "LESS";
+    case TokenType::GREATER:       return "GREATER";
+    case TokenType::EQUAL_EQUAL:   return "EQUAL_EQUAL";
+    case TokenType::BANG_EQUAL:    return "BANG_EQUAL";
+    case TokenType::LESS_EQUAL:    return "LESS_EQUAL";
+    case TokenType::GREATER_EQUAL: return "GREATER_EQUAL";
+    case TokenType::STRING:        return "STRING";
+    case TokenType::NUMBER:        return "NUMBER";
+    case TokenType::LITERAL:       return "LITERAL";
+    case TokenType::AND:           return "AND";
+    case TokenType::CLASS:         return "CLASS";
+    case TokenType::ELSE:          return "ELSE";
+    case TokenType::FALSE:         return "FALSE";
+    case TokenType::FOR:           return "FOR";
+    case TokenType::FUN:           return "FUN";
+    case TokenType::IF:            return "IF";
+    case TokenType::NIL:           return "NIL";
+    case TokenType::OR:            return "OR";
+    case TokenType::PRINT:         return "PRINT";
+    case TokenType::RETURN:        return "RETURN";
+    case TokenType::SUPER:         return "SUPER";
+    case TokenType::THIS:          return "THIS";
+    case TokenType::TRUE:          return "TRUE";
+    case TokenType::VAR:           return "VAR";
+    case TokenType::WHILE:         return "WHILE";
+    case TokenType::IDENTIFIER:    return "IDENTIFIER";
+    case TokenType::END_OF_FILE:   return "EOF";
+    }
+    return "";
+}
+
+constexpr std::string_view token_symbol(TokenType type)
+{
+    switch(type)
+    {
+    case TokenType::LEFT_PAREN:    return "(";
+    case TokenType::RIGHT_PAREN:   return ")";
+    case TokenType::LEFT_BRACE:    return "{";
+    case TokenType::RIGHT_BRACE:   return "}";
+    case TokenType::COMMA:         return ",";
+    case TokenType::DOT:           return ".";
+    case TokenType::MINUS:         return "-";
+    case TokenType::PLUS:          return "+";
+    case TokenType::SEMICOLON:     return ";";
+    case TokenType::SLASH:         return "/";
+    case TokenType::STAR:          return "*";
+    case TokenType::EQUAL:         return "=";
+    case TokenType::BANG:          return "!";
+    case TokenType::LESS:          return "<";
+    case TokenType::GREATER:       return ">";
+    case TokenType::EQUAL_EQUAL:   return "==";
+    case TokenType::BANG_EQUAL:    return "!=";
+    case TokenType::LESS_EQUAL:    return "<=";
+    case TokenType::GREATER_EQUAL: return ">=";
+    default:                       return "";
+    }
+}
+
+// single character operators; two character ones are formed by the scanner
+// from these when followed by '='
+constexpr TokenType single_char_token(char c)
+{
+    switch(c)
+    {
+    case '(': return TokenType::LEFT_PAREN;
+    case ')': return TokenType::RIGHT_PAREN;
+    case '{': return TokenType::LEFT_BRACE;
+    case '}': return TokenType::RIGHT_BRACE;
+    case ',': return TokenType::COMMA;
+    case '.': return TokenType::DOT;
+    case '-': return TokenType::MINUS;
+    case '+': return TokenType::PLUS;
+    case ';': return TokenType::SEMICOLON;
+    case '/': return TokenType::SLASH;
+    case '*': return TokenType::STAR;
+    case '=': return TokenType::EQUAL;
+    case '!': return TokenType::BANG;
+    case '<': return TokenType::LESS;
+    case '>': return TokenType::GREATER;
+    default:  return TokenType::END_OF_FILE;
+    }
+}
+
+constexpr TokenType two_char_token(char c)
+{
+    switch(c)
+    {
+    case '=': return TokenType::EQUAL_EQUAL;
+    case '!': return TokenType::BANG_EQUAL;
+    case '<': return TokenType::LESS_EQUAL;
+    case '>': return TokenType::GREATER_EQUAL;
+    default:  return TokenType::END_OF_FILE;
+    }
+}
+
+constexpr TokenType check_keyword(std::string_view s, size_t start, std::string_view rest, TokenType type)
+{
+    return s.size() == start + rest.size() && s.substr(start) == rest ? type : TokenType::IDENTIFIER;
+}
+
+// reserved word recognizer: dispatches on the first one or two characters
+// and compares the remainder, so no lookup table or temporary string is
+// involved. returns IDENTIFIER for anything that is not a keyword
+constexpr TokenType keyword_type(std::string_view s)
+{
+    if(s.size() < 2 || s.size() > 6)
+    {
+        return TokenType::IDENTIFIER;
+    }
+    switch(s[0])
+    {
+    case 'a': return check_keyword(s, 1, "nd", TokenType::AND);
+    case 'c': return check_keyword(s, 1, "lass", TokenType::CLASS);
+    case 'e': return check_keyword(s, 1, "lse", TokenType::ELSE);
+    case 'f':
+        switch(s[1])
+        {
+        case 'a': return check_keyword(s, 2, "lse", TokenType::FALSE);
+        case 'o': return check_keyword(s, 2, "r", TokenType::FOR);
+        case 'u': return check_keyword(s, 2, "n", TokenType::FUN);
+        }
+        break;
+    case 'i': return check_keyword(s, 1, "f", TokenType::IF);
+    case 'n': return check_keyword(s, 1, "il", TokenType::NIL);
+    case 'o': return check_keyword(s, 1, "r", TokenType::OR);
+    case 'p': return check_keyword(s, 1, "rint", TokenType::PRINT);
+    case 'r': return check_keyword(s, 1, "eturn", TokenType::RETURN);
+    case 's': return check_keyword(s, 1, "uper", TokenType::SUPER);
+    case 't':
+        switch(s[1])
+        {
+        case 'h': return check_keyword(s, 2, "is", TokenType::THIS);
+        case 'r': return check_keyword(s, 2, "ue", TokenType::TRUE);
+        }
+        break;
+    case 'v': return check_keyword(s, 1, "ar", TokenType::VAR);
+    case 'w': return check_keyword(s, 1, "hile", TokenType::WHILE);
+    }
+    return TokenType::IDENTIFIER;
+}
 
-const std::map<std::string, TokenType> reservedkeywords = {{"and", TokenType::AND},
-                                                           {"class", TokenType::CLASS},
-                                                           {"else", TokenType::ELSE},
-                                                           {"false", TokenType::FALSE},
-                                                           {"for", TokenType::FOR},
-                                                           {"fun", TokenType::FUN},
-                                                           {"if", TokenType::IF},
-                                                           {"nil", TokenType::NIL},
-                                                           {"or", TokenType::OR},
-                                                           {"print", TokenType::PRINT},
-                                                           {"return", TokenType::RETURN},
-                                                           {"super", TokenType::SUPER},
-                                                           {"this", TokenType::THIS},
-                                                           {"true", TokenType::TRUE},
-                                                           {"var", TokenType::VAR},
-                                                           {"while", TokenType::WHILE}};
+static_assert(keyword_type("while") == TokenType::WHILE);
+static_assert(keyword_type("this") == TokenType::THIS);
+static_assert(keyword_type("fun") == TokenType::FUN);
+static_assert(keyword_type("fund") == TokenType::IDENTIFIER);
+static_assert(keyword_type("t") == TokenType::IDENTIFIER);
+static_assert(single_char_token('.') == TokenType::DOT);
+static_assert(two_char_token('<') == TokenType::LESS_EQUAL);
 
 } // namespace lox
 
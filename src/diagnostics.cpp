@@ -0,0 +1,28 @@
+#include "diagnostics.h"
+
+namespace lox {
+void Diagnostics::error(int line, std::string_view where, std::string_view message)
+{
+    sink << "[line " << line << "] Error" << where << ": " << message << std::endl;
+    errors++;
+}
+
+void Diagnostics::runtime_error(int line, std::string_view message)
+{
+    sink << message << "\n[line " << line << "]" << std::endl;
+    runtime_errors++;
+}
+
+int Diagnostics::exit_code() const
+{
+    if(errors > 0) return 65;
+    if(runtime_errors > 0) return 70;
+    return 0;
+}
+
+void Diagnostics::reset()
+{
+    errors         = 0;
+    runtime_errors = 0;
+}
+} // namespace lox
@@ -0,0 +1,52 @@
+#ifndef DIAGNOSTICS_H
+#define DIAGNOSTICS_H
+
+#include <iostream>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+
+namespace lox {
+// collects the errors of one interpreter session. reports are written to the
+// sink as they happen and only on the failure path; the session decides what
+// to do about them (the command line turns them into exit codes 65 and 70)
+class Diagnostics
+{
+  public:
+    explicit Diagnostics(std::ostream &sink = std::cerr) : sink(sink) {}
+
+    // lexical, syntax and compile errors: "[line N] Error<where>: message"
+    void error(int line, std::string_view where, std::string_view message);
+    // errors while running: "message" followed by "[line N]"
+    void runtime_error(int line, std::string_view message);
+
+    bool had_error() const
+    {
+        return errors > 0;
+    }
+    bool had_runtime_error() const
+    {
+        return runtime_errors > 0;
+    }
+    // 65 after a static error, 70 after a runtime error, 0 otherwise
+    int  exit_code() const;
+    void reset();
+
+  private:
+    std::ostream &sink;
+    int           errors         = 0;
+    int           runtime_errors = 0;
+};
+
+// thrown by the tree-walker when evaluation fails; nothing is built unless
+// an error actually happens
+class RuntimeError : public std::runtime_error
+{
+  public:
+    RuntimeError(int line, const std::string &message) : std::runtime_error(message), line(line) {}
+
+    int line;
+};
+} // namespace lox
+
+#endif // DIAGNOSTICS_H
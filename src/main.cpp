@@ -1,306 +1,464 @@
+#include <algorithm>
+#include <cctype>
+#include <cstdlib>
 #include <cstring>
-#include <fstream>
+#include <filesystem>
 #include <iostream>
+#include <optional>
 #include <sstream>
 #include <string>
+#include <string_view>
+#include <thread>
+#include <unistd.h>
+#include "source.h"
 #include "scanner.h"
 #include "parser.h"
+#include "program_cache.h"
+#include "compiler.h"
+#include "optimizer.h"
+#include "output.h"
+#include "parallel_scanner.h"
+#include "server.h"
+#include "session.h"
+#include "stats.h"
+#include "vm.h"
 
-std::string read_file_contents(const std::string& filename);
 using lox::Scanner;
 
-void print_tokens(const std::vector<lox::Token>& tokens) {
-    for (const auto& token : tokens) {
-        std::cout << token << std::endl;
-    }
-}
+using lox::Engine;
 
-void handle_tokenize(const std::string& file_contents) {
-    if (!file_contents.empty()) {
-        Scanner scanner(file_contents);
-        auto tokens = scanner.get_tokens();
-        print_tokens(tokens);
-    } else {
-        std::cout << "EOF  null" << std::endl;
+// the tokenize output of one chunk, formatted ahead of time on a worker;
+// error i is reported right before text[error_offsets[i]] is written
+struct FormattedChunk {
+    std::string text;
+    std::vector<size_t> error_offsets;
+};
+
+FormattedChunk format_chunk(const lox::ScannedChunk& chunk) {
+    std::ostringstream text;
+    FormattedChunk formatted;
+    size_t error = 0;
+    for (size_t i = 0; i <= chunk.tokens.size(); i++) {
+        for (; error < chunk.errors.size() && chunk.error_positions[error] == i; error++) {
+            formatted.error_offsets.push_back(text.tellp());
+        }
+        if (i < chunk.tokens.size()) {
+            text << chunk.tokens[i] << '\n';
+        }
     }
+    formatted.text = std::move(text).str();
+    return formatted;
 }
 
-void handle_parse(const std::string& file_contents) {
-    if (!file_contents.empty()) {
-        std::vector<lox::Token> tokens;
-        {
-            Scanner scanner(file_contents);
-            tokens = scanner.get_tokens();
+// scans and formats on `threads` threads, then writes the chunks in order with
+// every lexical error reported where a serial scan would have
+void tokenize_parallel(std::string_view file_contents, unsigned threads, std::ostream& out,
+                       lox::Diagnostics& diagnostics, lox::Stats* stats) {
+    lox::ThreadPool pool(threads);
+    std::vector<lox::ScannedChunk> chunks = lox::scan_parallel(file_contents, pool);
+    if (stats) {
+        for (const lox::ScannedChunk& chunk : chunks) {
+            stats->tokens += chunk.tokens.size();
         }
-        if (!tokens.empty()) {
-            lox::Parser parser(tokens);
-            auto expr = parser.parse();
-            if (expr) {
-                std::cout << expr->form_string() << std::endl;
-            } else {
-                exit(65);
-            }
+        stats->tokens--; // END_OF_FILE
+    }
+
+    std::vector<FormattedChunk> formatted(chunks.size());
+    pool.parallel_for(chunks.size(), [&](size_t i) { formatted[i] = format_chunk(chunks[i]); });
+    for (size_t i = 0; i < chunks.size(); i++) {
+        std::string_view text = formatted[i].text;
+        size_t written = 0;
+        for (size_t e = 0; e < chunks[i].errors.size(); e++) {
+            size_t offset = formatted[i].error_offsets[e];
+            out.write(text.data() + written, offset - written);
+            diagnostics.error(chunks[i].errors[e].line, "", chunks[i].errors[e].message);
+            written = offset;
         }
-    } else {
-        std::cout << "EOF  null" << std::endl;
+        out.write(text.data() + written, text.size() - written);
     }
 }
 
-std::string get_evaluation_result(const lox::EvalResult& result) {
-    std::stringstream ss;
-    if (std::holds_alternative<double>(result)) {
-        ss << std::get<double>(result);
-    } else if (std::holds_alternative<bool>(result)) {
-        ss << (std::get<bool>(result) == 0 ? "false" : "true");
+// every handler reports errors to `diagnostics` and returns the exit code;
+// `stats`, when not null, collects phase times and counters for --stats
+
+// `scan_threads` > 0 scans on that many threads, for very large inputs. the
+// whole loop is timed as one SCAN phase; only writes to the descriptor are not
+int handle_tokenize(std::string_view file_contents, unsigned scan_threads, std::ostream& out,
+                    lox::Diagnostics& diagnostics, lox::Stats* stats) {
+    lox::PhaseTimer timer(stats, lox::Phase::SCAN);
+    if (!file_contents.empty() && scan_threads > 0) {
+        tokenize_parallel(file_contents, scan_threads, out, diagnostics, stats);
+    } else if (!file_contents.empty()) {
+        Scanner scanner(file_contents, diagnostics);
+        scanner.set_stats(stats);
+        lox::Token token = scanner.next_token();
+        for (; token.type != lox::TokenType::END_OF_FILE; token = scanner.next_token()) {
+            out << token << '\n';
+        }
+        out << token << '\n';
     } else {
-        ss << std::get<std::string>(result);
+        out << "EOF  null" << '\n';
     }
-    return ss.str();
+    return diagnostics.exit_code();
 }
 
-std::string get_evaluation_result(const std::shared_ptr<lox::Expression>& expr) {
-    if(!expr)
-    {
-        exit(65);
+// parses a single expression straight off the scanner, still scanning the
+// rest of the input so lexical errors anywhere are reported
+lox::Expression *parse_expression_stream(std::string_view file_contents, lox::Arena& arena, lox::Heap& heap,
+                                         lox::Diagnostics& diagnostics, lox::Stats* stats) {
+    lox::PhaseTimer timer(stats, lox::Phase::PARSE);
+    Scanner scanner(file_contents, diagnostics);
+    scanner.set_stats(stats);
+    lox::Parser parser(scanner, arena, heap, diagnostics);
+    auto expr = parser.parse();
+    scanner.finish();
+    if (stats) {
+        stats->nodes = arena.objects_allocated();
     }
-    auto result = expr->evaluate();
-    return get_evaluation_result(result);
+    return diagnostics.had_error() ? nullptr : expr;
 }
 
-std::string evaluate_expression(std::vector<lox::Token> tokens)
-{
-    if (!tokens.empty()) {
-        lox::Parser parser(tokens);
-        auto expr = parser.parse();
-        if (expr) {
-            auto result = expr->evaluate();
-            return get_evaluation_result(result);
-        } else {
-            exit(65);
+// with `optimized` the tree is printed after constant folding
+int handle_parse(std::string_view file_contents, bool optimized, std::ostream& out, lox::Diagnostics& diagnostics,
+                 lox::Stats* stats) {
+    if (!file_contents.empty()) {
+        lox::Arena arena;
+        lox::Heap heap;
+        auto expr = parse_expression_stream(file_contents, arena, heap, diagnostics, stats);
+        if (!expr) {
+            return 65;
+        }
+        if (optimized) {
+            lox::PhaseTimer timer(stats, lox::Phase::COMPILE);
+            expr = lox::Optimizer(arena, heap).optimize(expr);
         }
+        lox::PhaseTimer timer(stats, lox::Phase::OUTPUT);
+        out << expr->form_string() << '\n';
+    } else {
+        out << "EOF  null" << '\n';
     }
-    return "";
+    return 0;
 }
 
-void handle_evaluate(const std::string &file_contents)
-{
-    if(!file_contents.empty())
-    {
-        std::vector<lox::Token> tokens;
-        {
-            Scanner scanner(file_contents);
-            tokens = scanner.get_tokens();
-        }
-        std::cout << evaluate_expression(tokens) << std::endl;
+// `evaluate` and `run` are thin wrappers around a lox::Session
+int handle_evaluate(std::string_view file_contents, Engine engine, std::ostream& out, lox::Stats* stats) {
+    if (file_contents.empty()) {
+        return 0;
+    }
+    lox::Session session(engine);
+    session.set_output(out);
+    session.set_error_output(std::cerr);
+    session.set_stats(stats);
+    if (session.evaluate(file_contents)) {
+        out << session.result() << '\n';
     }
+    return session.status();
 }
 
-void split_into_statements(const std::vector<lox::Token> &tokens, std::vector<std::vector<lox::Token>> &statements)
-{
+int handle_run(lox::SourceBuffer source, Engine engine, const lox::ProgramCache* cache, std::ostream& out, lox::Stats* stats) {
+    lox::Session session(engine);
+    session.set_output(out);
+    session.set_error_output(std::cerr);
+    session.set_stats(stats);
+    session.set_cache(cache);
+    if (session.load(std::move(source))) {
+        session.run();
+    }
+    return session.status();
+}
 
-    for(size_t i = 0; i < tokens.size();)
-    {
-        std::vector<lox::Token> statement;
-        while(tokens[i].type != lox::TokenType::SEMICOLON &&
-              tokens[i].type != lox::TokenType::END_OF_FILE)
-        {
-            statement.push_back(tokens[i]);
-            i++;
+// one script of a batch, run in a session of its own
+struct BatchJob {
+    std::string path;  // as the manifest lists it
+    std::string file;  // resolved against the manifest's directory
+    std::string out;
+    std::string err;
+    int status = 1;
+};
+
+void run_job(BatchJob& job, Engine engine, const lox::ProgramCache* cache) {
+    std::ostringstream out;
+    std::ostringstream err;
+    try {
+        lox::Session session(engine);
+        session.set_output(out);
+        session.set_error_output(err);
+        session.set_cache(cache);
+        if (session.load_file(job.file)) {
+            session.run();
         }
-        if(tokens[i].type == lox::TokenType::SEMICOLON ||
-           tokens[i].type == lox::TokenType::END_OF_FILE)
-        {
-            i++;
+        job.status = session.status();
+    } catch (const std::exception& error) {
+        err << "Internal error: " << error.what() << '\n';
+        job.status = 70;
+    }
+    job.out = std::move(out).str();
+    job.err = std::move(err).str();
+}
+
+// runs every script listed in `manifest` (one path per line; blank lines and
+// lines starting with '#' are skipped) on `jobs` threads. relative paths are
+// taken from the directory of the manifest file `manifest_path`. in manifest order,
+// each script's stdout follows a "### <path> (exit <status>)" line on stdout
+// and its stderr, if any, a "### <path>" line on stderr. returns the highest
+// exit status of the batch
+int handle_run_batch(std::string_view manifest, const std::string& manifest_path, Engine engine,
+                     const lox::ProgramCache* cache, unsigned jobs, std::ostream& out) {
+    const std::filesystem::path directory = std::filesystem::path(manifest_path).parent_path();
+    std::vector<BatchJob> batch;
+    while (!manifest.empty()) {
+        size_t end = std::min(manifest.find('\n'), manifest.size());
+        std::string_view line = manifest.substr(0, end);
+        manifest.remove_prefix(std::min(end + 1, manifest.size()));
+        while (!line.empty() && std::isspace(static_cast<unsigned char>(line.back()))) {
+            line.remove_suffix(1);
         }
-        if(statement.empty())
-        {
-            continue;
+        if (!line.empty() && line.front() != '#') {
+            BatchJob job;
+            job.path = line;
+            job.file = (directory / job.path).string();
+            batch.push_back(std::move(job));
         }
-        statement.push_back(lox::Token(lox::TokenType::END_OF_FILE, "EOF", "", 0));
-        statements.push_back(statement);
     }
-}
 
-std::shared_ptr<lox::Expression> parse_expression(const std::vector<lox::Token>& tokens) {
-    lox::Parser parser(tokens);
-    return parser.parse();
-}
+    lox::ThreadPool pool(jobs);
+    pool.parallel_for(batch.size(), [&](size_t i) { run_job(batch[i], engine, cache); });
 
-void update_expression_with_variables(std::shared_ptr<lox::Expression>& expr, std::map<std::string, std::shared_ptr<lox::Expression>> &variables) {
-    if (auto binary_expr = std::dynamic_pointer_cast<lox::Binary>(expr)) {
-        update_expression_with_variables(binary_expr->left, variables);
-        update_expression_with_variables(binary_expr->right, variables);
-    } else if (auto unary_expr = std::dynamic_pointer_cast<lox::Unary>(expr)) {
-        update_expression_with_variables(unary_expr->right, variables);
-    } else if (auto grouping_expr = std::dynamic_pointer_cast<lox::Grouping>(expr)) {
-        update_expression_with_variables(grouping_expr->expression, variables);
-    } else if (auto var_expr = std::dynamic_pointer_cast<lox::Literal>(expr)) {
-        if (variables.find(var_expr->value) != variables.end()) {
-            expr = variables[var_expr->value];
+    int status = 0;
+    for (const BatchJob& job : batch) {
+        out << "### " << job.path << " (exit " << job.status << ")\n" << job.out;
+        if (!job.err.empty()) {
+            out.flush();
+            std::cerr << "### " << job.path << '\n' << job.err;
         }
+        status = std::max(status, job.status);
     }
+    return status;
 }
 
-void update_statement_with_variables(std::vector<lox::Token>& statement, std::map<std::string, std::shared_ptr<lox::Expression>> &variables) {
-    for (auto& token : statement) {
-        if (token.type == lox::TokenType::IDENTIFIER) {
-            if (variables.find(token.lexeme) != variables.end()) {
-                token.type = lox::TokenType::NUMBER;
-                token.literal = get_evaluation_result(variables[token.lexeme]->evaluate());
-            }
+// an input goes on over further lines while it ends inside a string or has
+// more '(' than ')'; anything else is complete, errors included. no
+// expression holds a ';', so one inside parentheses ends the input too
+bool input_complete(std::string_view input) {
+    lox::Diagnostics diagnostics;
+    std::vector<lox::ScanError> errors;
+    Scanner scanner(input, diagnostics);
+    // collected only to keep them quiet: they are reported when the input runs
+    scanner.collect_errors(&errors);
+    int depth = 0;
+    for (lox::Token token = scanner.next_token(); token.type != lox::TokenType::END_OF_FILE; token = scanner.next_token()) {
+        if (token.type == lox::TokenType::LEFT_PAREN) {
+            depth++;
+        } else if (token.type == lox::TokenType::RIGHT_PAREN) {
+            depth--;
+        } else if (token.type == lox::TokenType::SEMICOLON && depth > 0) {
+            depth = 0;
         }
     }
+    return depth <= 0 && !scanner.ended_in_string();
 }
 
-bool handle_multiple_assignments(
-    std::vector<lox::Token>                                 &statement,
-    std::map<std::string, std::shared_ptr<lox::Expression>> &variables)
-{
-    bool retVal = false;
-    std::vector<std::vector<lox::Token>> statements;
-    std::vector<lox::Token> temp;
-    for(size_t i = 0; i < statement.size(); i++)
-    {
-        if(statement[i].type == lox::TokenType::EQUAL ||
-           statement[i].type == lox::TokenType::END_OF_FILE)
-        {
-            if(statement[i].type == lox::TokenType::EQUAL)
-            {
-                retVal = true;
+// reads inputs from stdin and runs each against one session, so variables
+// live on from input to input while only the new input is scanned and
+// parsed. errors are reported and the loop carries on; prompts are shown
+// only on a terminal. with stats, each input's report follows its output.
+// returns the status of the last input
+int handle_repl(Engine engine, lox::OutputBuffer& buffer, std::ostream& out, lox::Stats* stats) {
+    lox::Session session(engine);
+    session.set_output(out);
+    session.set_error_output(std::cerr);
+    const bool interactive = isatty(STDIN_FILENO);
+
+    int status = 0;
+    int line_number = 1;
+    std::string input;
+    std::string line;
+    for (;;) {
+        if (interactive) {
+            out << (input.empty() ? "> " : "... ") << std::flush;
+        }
+        bool read = static_cast<bool>(std::getline(std::cin, line));
+        if (read) {
+            input += line;
+            input += '\n';
+            if (!input_complete(input)) {
+                continue;
             }
-            statements.push_back(temp);
-            temp.clear();
+        } else if (input.empty()) {
+            break;
         }
-        else
-        {
-            temp.push_back(statement[i]);
+
+        // an input still open at the end runs as it is, to report the error
+        lox::Stats input_stats;
+        size_t written = buffer.bytes_written();
+        session.set_stats(stats ? &input_stats : nullptr);
+        session.execute(input, line_number);
+        status = session.status();
+        if (stats) {
+            out.flush();
+            input_stats.bytes_written = buffer.bytes_written() - written;
+            input_stats.report(std::cerr);
+        }
+        line_number += std::count(input.begin(), input.end(), '\n');
+        input.clear();
+        if (!read) {
+            break;
         }
     }
-    statements[statements.size() - 1].push_back(lox::Token(lox::TokenType::END_OF_FILE, "EOF", "", 0));
-    update_statement_with_variables(statements[statements.size() - 1], variables);
-     auto result =
-        parse_expression(statements[statements.size() - 1]);
-    statements.pop_back();
-    for(auto statement : statements)
-    {
-        variables[statement[0].lexeme] = result;
+    if (interactive) {
+        out << '\n';
     }
-    statement = statements[0];
-    return retVal;
+    return status;
 }
 
-void handle_statement(std::vector<lox::Token>& statement, std::map<std::string, std::shared_ptr<lox::Expression>>& variables) {
-    bool print = false;
-    bool isVar = false;
-    if(statement[0].type == lox::TokenType::PRINT)
-    {
-        print = true;
-        statement.erase(statement.begin());
-    } else if(statement[0].type == lox::TokenType::VAR)
-    {
-        isVar = true;
-        statement.erase(statement.begin());
+// output that could not be written fails the command even if the script
+// itself succeeded: 74 is the I/O error status of sysexits.h
+int check_output(std::ostream& out, const lox::OutputBuffer& buffer, int status) {
+    if (out) {
+        return status;
     }
-    auto                                 _statement = statement;
-    std::vector<std::vector<lox::Token>> statements;
-    if(statement.size() == 1 && statement[0].type == lox::TokenType::END_OF_FILE)
-    {
-        exit(65);
-    }
-    std::string                          var_name = statement[0].lexeme;
-    if(statement.size() == 2 && statement[1].type == lox::TokenType::END_OF_FILE &&
-       statement[0].type == lox::TokenType::IDENTIFIER)
-    {
-        if(isVar)
-        {
-            variables[statement[0].lexeme] = std::make_shared<lox::Literal>("nil");
-            return;
-        } else if(print)
-        {
-            std::cout << get_evaluation_result(variables[statement[0].lexeme]->evaluate()) << std::endl;
-            return;
-        }
+    std::cerr << "Error writing output: " << std::strerror(buffer.write_error()) << std::endl;
+    return std::max(status, 74);
+}
+
+int main(int argc, char *argv[]) {
+    std::cerr << std::unitbuf;
+
+    if (argc < 2) {
+        std::cerr << "Usage: ./your_program <command> <filename> [--engine=tree|vm] [--optimized] [--flush=line|full] [--scan-threads=N] [--jobs=N] [--socket=PATH] [--cache-dir=DIR] [--stats]" << std::endl;
+        return 1;
     }
-    if(handle_multiple_assignments(statement, variables))
-    {
-        if(print && statement.size() == 1)
-        {
-            std::cout << get_evaluation_result(variables[statement[0].literal]->evaluate())
-                      << std::endl;
+
+    const std::string command = argv[1];
+    const char *filename = nullptr;
+    std::string socket_path;
+    std::string cache_dir;
+    Engine engine = Engine::TREE;
+    bool engine_chosen = false;
+    bool optimized = false;
+    bool report_stats = false;
+    unsigned scan_threads = 0;
+    unsigned jobs = 0;
+    // interactive output is flushed per line, pipes and files in large blocks
+    lox::FlushMode flush = isatty(STDOUT_FILENO) ? lox::FlushMode::LINE : lox::FlushMode::FULL;
+    for (int i = 2; i < argc; i++) {
+        const std::string option = argv[i];
+        if (!option.starts_with("--") && !filename) {
+            filename = argv[i];
+        } else if (option == "--engine=tree") {
+            engine = Engine::TREE;
+            engine_chosen = true;
+        } else if (option == "--engine=vm") {
+            engine = Engine::VM;
+            engine_chosen = true;
+        } else if (option == "--optimized") {
+            optimized = true;
+        } else if (option == "--flush=line") {
+            flush = lox::FlushMode::LINE;
+        } else if (option == "--flush=full") {
+            flush = lox::FlushMode::FULL;
+        } else if (option.starts_with("--scan-threads=")) {
+            // 0 picks one thread per core
+            int threads = std::atoi(option.c_str() + std::strlen("--scan-threads="));
+            scan_threads = threads > 0 ? threads : std::max(1u, std::thread::hardware_concurrency());
+        } else if (option.starts_with("--jobs=")) {
+            // run-batch threads and serve workers, 0 for one per core
+            jobs = std::max(0, std::atoi(option.c_str() + std::strlen("--jobs=")));
+        } else if (option.starts_with("--socket=")) {
+            socket_path = option.substr(std::strlen("--socket="));
+        } else if (option == "--socket" && i + 1 < argc) {
+            socket_path = argv[++i];
+        } else if (option.starts_with("--cache-dir=")) {
+            cache_dir = option.substr(std::strlen("--cache-dir="));
+        } else if (option == "--cache-dir" && i + 1 < argc) {
+            cache_dir = argv[++i];
+        } else if (option == "--stats") {
+            report_stats = true;
+        } else {
+            std::cerr << "Unknown option: " << option << std::endl;
+            return 1;
         }
     }
-    else 
-    {
-        update_statement_with_variables(_statement, variables);
-        auto expr = parse_expression(_statement);
-        if(print)
-        {
-            std::cout << get_evaluation_result(expr->evaluate()) << std::endl;
-        }
-        else
-        {
-            //variables[var_name] = expr;
+
+    // only bytecode is cached, so a cache directory selects the VM
+    std::optional<lox::ProgramCache> cache;
+    if (!cache_dir.empty()) {
+        if (engine_chosen && engine != Engine::VM) {
+            std::cerr << "--cache-dir needs --engine=vm" << std::endl;
+            return 1;
         }
+        engine = Engine::VM;
+        cache.emplace(cache_dir);
     }
 
-}
-
-void handle_run(const std::string &file_contents) {
-    std::map<std::string, std::shared_ptr<lox::Expression>> variables;
-    if (!file_contents.empty()) {
-        std::vector<lox::Token> tokens;
-        {
-            Scanner scanner(file_contents);
-            tokens = scanner.get_tokens();
-        }
+    // collection is off unless asked for: every component checks this pointer
+    lox::Stats session_stats;
+    lox::Stats *stats = report_stats ? &session_stats : nullptr;
 
-        std::vector<std::vector<lox::Token>> statements;
-        split_into_statements(tokens, statements);
-        for (auto& statement : statements) {
-            handle_statement(statement, variables);
+    // the daemon reads its scripts from the socket, everything else from a file
+    if (command == "serve") {
+        if (socket_path.empty()) {
+            std::cerr << "Usage: ./your_program serve --socket <path> [--engine=tree|vm] [--jobs=N]" << std::endl;
+            return 1;
         }
+        return lox::serve(socket_path, engine, jobs, std::cerr);
+    }
+    // the repl reads stdin and writes every line of output as it comes
+    if (command == "repl") {
+        lox::OutputBuffer buffer(STDOUT_FILENO, lox::FlushMode::LINE);
+        std::ostream out(&buffer);
+        std::cerr.tie(&out);
+        int status = handle_repl(engine, buffer, out, stats);
+        out.flush();
+        std::cerr.tie(nullptr);
+        return check_output(out, buffer, status);
+    }
+    if (!filename || (command == "client" && socket_path.empty())) {
+        std::cerr << "Usage: ./your_program <command> <filename> [options] (repl reads stdin instead), client also needs --socket <path>" << std::endl;
+        return 1;
     }
-}
-
-int main(int argc, char *argv[]) {
-    // Disable output buffering
-    std::cout << std::unitbuf;
-    std::cerr << std::unitbuf;
 
-    if (argc < 3) {
-        std::cerr << "Usage: ./your_program <command> <filename>" << std::endl;
+    lox::SourceBuffer source;
+    bool loaded;
+    {
+        lox::PhaseTimer timer(stats, lox::Phase::READ);
+        loaded = source.load(filename);
+    }
+    if (!loaded) {
+        std::cerr << "Error reading file: " << filename << std::endl;
         return 1;
     }
+    std::string_view file_contents = source.view();
 
-    const std::string command = argv[1];
-    std::string file_contents = read_file_contents(argv[2]);
+    // program output is buffered; error reports flush it first so the two
+    // streams still interleave in order
+    lox::OutputBuffer buffer(STDOUT_FILENO, flush);
+    buffer.set_stats(stats);
+    std::ostream out(&buffer);
+    std::cerr.tie(&out);
 
+    lox::Diagnostics diagnostics;
+    int status = 1;
     if (command == "tokenize") {
-        handle_tokenize(file_contents);
+        status = handle_tokenize(file_contents, scan_threads, out, diagnostics, stats);
     } else if (command == "parse") {
-        handle_parse(file_contents);
+        status = handle_parse(file_contents, optimized, out, diagnostics, stats);
     } else if (command == "evaluate") {
-        handle_evaluate(file_contents);
+        status = handle_evaluate(file_contents, engine, out, stats);
     } else if (command == "run") {
-        handle_run(file_contents);
+        status = handle_run(std::move(source), engine, cache ? &*cache : nullptr, out, stats);
+    } else if (command == "run-batch") {
+        status = handle_run_batch(file_contents, filename, engine, cache ? &*cache : nullptr, jobs, out);
+    } else if (command == "client") {
+        status = lox::submit(socket_path, file_contents, out, std::cerr);
     } else {
         std::cerr << "Unknown command: " << command << std::endl;
-        return 1;
     }
-
-    return 0;
-}
-
-std::string read_file_contents(const std::string& filename) {
-    std::ifstream file(filename);
-    if (!file.is_open()) {
-        std::cerr << "Error reading file: " << filename << std::endl;
-        std::exit(1);
+    out.flush();
+    std::cerr.tie(nullptr);
+    if (stats) {
+        stats->bytes_written = buffer.bytes_written();
+        stats->report(std::cerr);
     }
-
-    std::stringstream buffer;
-    buffer << file.rdbuf();
-    file.close();
-
-    return buffer.str();
+    return check_output(out, buffer, status);
 }
@@ -0,0 +1,196 @@
+#include "optimizer.h"
+#include <cmath>
+
+namespace lox {
+namespace {
+const Literal *as_literal(const Expression *expr)
+{
+    return dynamic_cast<const Literal *>(expr);
+}
+
+bool is_number(const Expression *expr, double value)
+{
+    auto literal = as_literal(expr);
+    return literal && literal->value.is_number() && literal->value.as_number() == value;
+}
+
+// expressions that either produce a number or fail at runtime
+bool is_numeric(const Expression *expr)
+{
+    if(auto literal = as_literal(expr))
+    {
+        return literal->value.is_number();
+    }
+    if(auto unary = dynamic_cast<const Unary *>(expr))
+    {
+        return unary->op == TokenType::MINUS;
+    }
+    if(auto binary = dynamic_cast<const Binary *>(expr))
+    {
+        switch(binary->op)
+        {
+        case TokenType::MINUS:
+        case TokenType::STAR:
+        case TokenType::SLASH: return true;
+        case TokenType::PLUS:  return is_numeric(binary->left) || is_numeric(binary->right);
+        default:               return false;
+        }
+    }
+    return false;
+}
+
+// expressions that always produce a boolean
+bool is_boolean(const Expression *expr)
+{
+    if(auto literal = as_literal(expr))
+    {
+        return literal->value.is_bool();
+    }
+    if(auto unary = dynamic_cast<const Unary *>(expr))
+    {
+        return unary->op == TokenType::BANG;
+    }
+    if(auto binary = dynamic_cast<const Binary *>(expr))
+    {
+        switch(binary->op)
+        {
+        case TokenType::EQUAL_EQUAL:
+        case TokenType::BANG_EQUAL:
+        case TokenType::GREATER:
+        case TokenType::GREATER_EQUAL:
+        case TokenType::LESS:
+        case TokenType::LESS_EQUAL: return true;
+        default:                    return false;
+        }
+    }
+    return false;
+}
+} // namespace
+
+Expression *Optimizer::optimize(Expression *expr)
+{
+    if(auto binary = dynamic_cast<Binary *>(expr))
+    {
+        return this->binary(binary);
+    }
+    if(auto unary = dynamic_cast<Unary *>(expr))
+    {
+        return this->unary(unary);
+    }
+    if(auto grouping = dynamic_cast<Grouping *>(expr))
+    {
+        return optimize(grouping->expression);
+    }
+    if(auto assign = dynamic_cast<Assign *>(expr))
+    {
+        assign->value = optimize(assign->value);
+    }
+    return expr;
+}
+
+void Optimizer::optimize(Statement *statement)
+{
+    if(auto print = dynamic_cast<PrintStatement *>(statement))
+    {
+        print->expression = optimize(print->expression);
+    }
+    else if(auto expression = dynamic_cast<ExpressionStatement *>(statement))
+    {
+        expression->expression = optimize(expression->expression);
+    }
+    else if(auto var = dynamic_cast<VarStatement *>(statement))
+    {
+        if(var->initializer)
+        {
+            var->initializer = optimize(var->initializer);
+        }
+    }
+}
+
+Expression *Optimizer::binary(Binary *expr)
+{
+    expr->left  = optimize(expr->left);
+    expr->right = optimize(expr->right);
+
+    auto left  = as_literal(expr->left);
+    auto right = as_literal(expr->right);
+    if(left && right && foldable(expr->op, left->value, right->value))
+    {
+        // inf and nan have no literal syntax, so those operations stay
+        Value value = evaluate(expr);
+        if(!value.is_number() || std::isfinite(value.as_number()))
+        {
+            return arena.make<Literal>(value);
+        }
+    }
+
+    // x + 0 is left alone: it turns -0 into 0
+    switch(expr->op)
+    {
+    case TokenType::MINUS:
+        if(is_number(expr->right, 0) && is_numeric(expr->left)) return expr->left;
+        break;
+    case TokenType::STAR:
+        if(is_number(expr->right, 1) && is_numeric(expr->left)) return expr->left;
+        if(is_number(expr->left, 1) && is_numeric(expr->right)) return expr->right;
+        break;
+    case TokenType::SLASH:
+        if(is_number(expr->right, 1) && is_numeric(expr->left)) return expr->left;
+        break;
+    default:
+        break;
+    }
+    return expr;
+}
+
+Expression *Optimizer::unary(Unary *expr)
+{
+    expr->right = optimize(expr->right);
+
+    if(auto operand = as_literal(expr->right))
+    {
+        if(expr->op == TokenType::BANG || operand->value.is_number())
+        {
+            return arena.make<Literal>(evaluate(expr));
+        }
+        return expr;
+    }
+
+    // -(-x) and !!x cancel out when x already has the resulting type
+    auto inner = dynamic_cast<Unary *>(expr->right);
+    if(inner && inner->op == expr->op)
+    {
+        bool cancels = expr->op == TokenType::MINUS ? is_numeric(inner->right) : is_boolean(inner->right);
+        if(cancels)
+        {
+            return inner->right;
+        }
+    }
+    return expr;
+}
+
+bool Optimizer::foldable(TokenType op, Value left, Value right) const
+{
+    switch(op)
+    {
+    case TokenType::EQUAL_EQUAL:
+    case TokenType::BANG_EQUAL:    return true;
+    case TokenType::PLUS:          return (left.is_number() && right.is_number()) || (left.is_string() && right.is_string());
+    case TokenType::MINUS:
+    case TokenType::STAR:
+    case TokenType::SLASH:
+    case TokenType::GREATER:
+    case TokenType::GREATER_EQUAL:
+    case TokenType::LESS:
+    case TokenType::LESS_EQUAL:    return left.is_number() && right.is_number();
+    default:                       return false;
+    }
+}
+
+// only called on operands already checked to be valid, so this cannot fail
+Value Optimizer::evaluate(Expression *expr)
+{
+    Globals globals;
+    return expr->evaluate(heap, globals);
+}
+} // namespace lox
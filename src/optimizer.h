@@ -0,0 +1,32 @@
+#ifndef OPTIMIZER_H
+#define OPTIMIZER_H
+
+#include "parser.h"
+
+namespace lox {
+// simplifies a parsed expression before it runs: constant subtrees are
+// folded into literals, groupings are dropped and arithmetic identities on
+// operands known to be numbers are removed. only rewrites that cannot change
+// the result or turn a runtime error into a value are applied, and results
+// without a literal form (inf, nan) are left unfolded
+class Optimizer
+{
+  public:
+    // new nodes are allocated in `arena`; folded strings are interned in `heap`
+    Optimizer(Arena &arena, Heap &heap) : arena(arena), heap(heap) {}
+
+    Expression *optimize(Expression *expr);
+    void        optimize(Statement *statement);
+
+  private:
+    Expression *binary(Binary *expr);
+    Expression *unary(Unary *expr);
+    bool        foldable(TokenType op, Value left, Value right) const;
+    Value       evaluate(Expression *expr);
+
+    Arena &arena;
+    Heap  &heap;
+};
+} // namespace lox
+
+#endif // OPTIMIZER_H
@@ -0,0 +1,104 @@
+#include "output.h"
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <unistd.h>
+
+namespace lox {
+OutputBuffer::OutputBuffer(int fd, FlushMode mode, size_t capacity)
+    : fd(fd), mode(mode), buffer(new char[capacity]), capacity(capacity)
+{
+    if(mode == FlushMode::FULL)
+    {
+        setp(buffer.get(), buffer.get() + capacity);
+    }
+}
+
+OutputBuffer::~OutputBuffer()
+{
+    sync();
+}
+
+size_t OutputBuffer::bytes_written() const
+{
+    return written;
+}
+
+int OutputBuffer::write_error() const
+{
+    return error;
+}
+
+OutputBuffer::int_type OutputBuffer::overflow(int_type c)
+{
+    if(traits_type::eq_int_type(c, traits_type::eof()))
+    {
+        return sync() == 0 ? traits_type::not_eof(c) : traits_type::eof();
+    }
+    char ch = traits_type::to_char_type(c);
+    return xsputn(&ch, 1) == 1 ? c : traits_type::eof();
+}
+
+std::streamsize OutputBuffer::xsputn(const char *s, std::streamsize n)
+{
+    if(mode == FlushMode::FULL)
+    {
+        std::streamsize copied = 0;
+        while(copied < n)
+        {
+            if(pptr() == epptr() && !drain()) return copied;
+            std::streamsize room  = epptr() - pptr();
+            std::streamsize chunk = std::min(room, n - copied);
+            std::memcpy(pptr(), s + copied, chunk);
+            pbump(static_cast<int>(chunk));
+            copied += chunk;
+        }
+        return n;
+    }
+
+    std::streamsize copied = 0;
+    while(copied < n)
+    {
+        if(used == capacity && !drain()) return copied;
+        size_t chunk = std::min(capacity - used, static_cast<size_t>(n - copied));
+        std::memcpy(buffer.get() + used, s + copied, chunk);
+        used += chunk;
+        copied += chunk;
+    }
+    if(std::memchr(s, '\n', n) && !drain()) return 0;
+    return n;
+}
+
+int OutputBuffer::sync()
+{
+    return drain() ? 0 : -1;
+}
+
+// writes everything buffered so far, retrying short writes
+bool OutputBuffer::drain()
+{
+    size_t      pending = mode == FlushMode::FULL ? pptr() - pbase() : used;
+    const char *data    = buffer.get();
+    PhaseTimer  timer(pending > 0 ? stats : nullptr, Phase::OUTPUT);
+    while(pending > 0 && !failed)
+    {
+        ssize_t n = ::write(fd, data, pending);
+        if(n < 0)
+        {
+            if(errno == EINTR) continue;
+            failed = true;
+            error  = errno;
+            break;
+        }
+        data += n;
+        pending -= n;
+        written += n;
+    }
+    if(mode == FlushMode::FULL)
+    {
+        setp(buffer.get(), buffer.get() + capacity);
+    }
+    used = 0;
+    return !failed;
+}
+} // namespace lox
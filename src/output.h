@@ -0,0 +1,63 @@
+#ifndef OUTPUT_H
+#define OUTPUT_H
+
+#include "stats.h"
+#include <cstddef>
+#include <memory>
+#include <streambuf>
+
+namespace lox {
+enum class FlushMode
+{
+    LINE, // write out every completed line
+    FULL  // write out only when the buffer fills up, on flush and on exit
+};
+
+// stream buffer writing straight to a file descriptor through one large
+// buffer, so printing a line does not cost a system call. wrap it in an
+// std::ostream to use it; pending output is written when the buffer is
+// destroyed or the stream is flushed. once a write fails all later output is
+// dropped and the stream goes bad at the latest on its next flush
+class OutputBuffer : public std::streambuf
+{
+  public:
+    static constexpr size_t DEFAULT_CAPACITY = 64 * 1024;
+
+    explicit OutputBuffer(int fd, FlushMode mode = FlushMode::FULL, size_t capacity = DEFAULT_CAPACITY);
+    OutputBuffer(const OutputBuffer &)            = delete;
+    OutputBuffer &operator=(const OutputBuffer &) = delete;
+    ~OutputBuffer() override;
+
+    // bytes handed to the descriptor so far
+    size_t bytes_written() const;
+    // errno of the write that failed, 0 while none has
+    int    write_error() const;
+    // times writes to the descriptor into Phase::OUTPUT; null turns it off
+    void   set_stats(Stats *stats)
+    {
+        this->stats = stats;
+    }
+
+  protected:
+    int_type        overflow(int_type c) override;
+    std::streamsize xsputn(const char *s, std::streamsize n) override;
+    int             sync() override;
+
+  private:
+    bool drain();
+
+    int                     fd;
+    FlushMode               mode;
+    std::unique_ptr<char[]> buffer;
+    size_t                  capacity;
+    // in LINE mode the put area is left empty so every write comes through
+    // overflow()/xsputn() and newlines can be seen; `used` tracks the buffer
+    size_t                  used    = 0;
+    size_t                  written = 0;
+    bool                    failed  = false;
+    int                     error   = 0;
+    Stats                  *stats   = nullptr;
+};
+} // namespace lox
+
+#endif // OUTPUT_H
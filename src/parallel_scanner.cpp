@@ -0,0 +1,144 @@
+#include "parallel_scanner.h"
+#include <algorithm>
+#include <cstring>
+
+namespace lox {
+namespace {
+// slices smaller than this are not worth a thread
+constexpr size_t MIN_SLICE_SIZE    = 1 << 20;
+// more slices than threads, so one dense slice does not hold up the rest
+constexpr size_t SLICES_PER_THREAD = 4;
+
+struct Slice
+{
+    size_t begin;
+    size_t end;
+    int    line     = 1;
+    size_t newlines = 0;
+    bool   has_nul  = false;
+    // whether the slice ends inside a string, indexed by whether it starts in one
+    bool   ends_in_string[2]{};
+};
+
+// follows the scanner's lexical state just far enough to tell whether the
+// end of `text` is inside a string literal: outside strings '"' opens one
+// and "//" starts a comment running to the end of the line
+bool ends_in_string(std::string_view text, bool in_string)
+{
+    const char *p   = text.data();
+    const char *end = p + text.size();
+    while(p < end)
+    {
+        if(in_string)
+        {
+            p = static_cast<const char *>(std::memchr(p, '"', end - p));
+            if(!p) return true;
+            p++;
+            in_string = false;
+            continue;
+        }
+        char c = *p++;
+        if(c == '"')
+        {
+            in_string = true;
+        }
+        else if(c == '/' && p < end && *p == '/')
+        {
+            p = static_cast<const char *>(std::memchr(p, '\n', end - p));
+            if(!p) return false;
+        }
+    }
+    return in_string;
+}
+
+// the pre-pass over one slice
+void survey(std::string_view source, Slice &slice)
+{
+    std::string_view text   = source.substr(slice.begin, slice.end - slice.begin);
+    slice.newlines          = std::count(text.begin(), text.end(), '\n');
+    slice.has_nul           = text.find('\0') != std::string_view::npos;
+    slice.ends_in_string[0] = ends_in_string(text, false);
+    slice.ends_in_string[1] = ends_in_string(text, true);
+}
+
+// cuts `source` into about `count` slices, each starting right after a
+// newline, so no token other than a string can straddle two of them
+std::vector<Slice> cut(std::string_view source, size_t count)
+{
+    std::vector<Slice> slices;
+    size_t             begin = 0;
+    for(size_t k = 1; k < count; k++)
+    {
+        size_t target = std::max(begin, source.size() / count * k);
+        size_t cut    = source.find('\n', target);
+        if(cut == std::string_view::npos || cut + 1 >= source.size()) break;
+        slices.push_back({begin, cut + 1});
+        begin = cut + 1;
+    }
+    slices.push_back({begin, source.size()});
+    return slices;
+}
+
+void scan_slice(std::string_view text, int line, bool last, ScannedChunk &chunk)
+{
+    Diagnostics unused; // errors are collected, never reported
+    Scanner     scanner(text, unused, line);
+    scanner.collect_errors(&chunk.errors);
+    for(;;)
+    {
+        Token token = scanner.next_token();
+        // errors raised while scanning for this token come right before it
+        chunk.error_positions.resize(chunk.errors.size(), chunk.tokens.size());
+        if(token.type == TokenType::END_OF_FILE)
+        {
+            if(last) chunk.tokens.push_back(token);
+            return;
+        }
+        chunk.tokens.push_back(token);
+    }
+}
+} // namespace
+
+std::vector<ScannedChunk> scan_parallel(std::string_view source, ThreadPool &pool)
+{
+    size_t             wanted = std::min(source.size() / MIN_SLICE_SIZE, size_t(pool.size()) * SLICES_PER_THREAD);
+    std::vector<Slice> slices = cut(source, std::max<size_t>(wanted, 1));
+
+    pool.parallel_for(slices.size(), [&](size_t i) { survey(source, slices[i]); });
+
+    // a NUL byte cuts comments and strings short in the scanner, which the
+    // pre-pass does not model; such input is scanned as one slice
+    if(std::any_of(slices.begin(), slices.end(), [](const Slice &slice) { return slice.has_nul; }))
+    {
+        slices = {Slice{0, source.size()}};
+    }
+
+    // prefix pass: a slice starting inside a string joins the one before it,
+    // everything else learns its first line number
+    std::vector<Slice> joined;
+    bool               in_string = false;
+    int                line      = 1;
+    for(const Slice &slice: slices)
+    {
+        if(in_string)
+        {
+            joined.back().end = slice.end;
+        }
+        else
+        {
+            joined.push_back({slice.begin, slice.end, line});
+        }
+        in_string = slice.ends_in_string[in_string];
+        line += static_cast<int>(slice.newlines);
+    }
+
+    std::vector<ScannedChunk> chunks(joined.size());
+    pool.parallel_for(joined.size(), [&](size_t i) {
+        // no Stats: the caller times the whole scan, this only tags the worker's allocations as SCAN
+        PhaseTimer   phase(nullptr, Phase::SCAN);
+        const Slice &slice = joined[i];
+        scan_slice(source.substr(slice.begin, slice.end - slice.begin), slice.line, i + 1 == joined.size(), chunks[i]);
+    });
+    return chunks;
+}
+} // namespace lox
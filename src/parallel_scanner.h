@@ -0,0 +1,29 @@
+#ifndef PARALLEL_SCANNER_H
+#define PARALLEL_SCANNER_H
+
+#include "scanner.h"
+#include "thread_pool.h"
+#include <cstddef>
+#include <string_view>
+#include <vector>
+
+namespace lox {
+// the tokens of one slice of the source. errors[i] is reported just before
+// tokens[error_positions[i]], where a serial Scanner would have reported it
+struct ScannedChunk
+{
+    std::vector<Token>     tokens;
+    std::vector<ScanError> errors;
+    std::vector<size_t>    error_positions;
+};
+
+// tokenizes `source` on the threads of `pool`. the input is cut after
+// newlines into slices that start outside any string (a pre-pass works out
+// which ones do, in parallel), every slice is scanned on its own starting
+// from its line number, and the concatenated chunks hold exactly the tokens
+// and errors of a serial scan, the last chunk ending with END_OF_FILE.
+// inputs too small to be worth splitting come back as a single chunk
+std::vector<ScannedChunk> scan_parallel(std::string_view source, ThreadPool &pool);
+} // namespace lox
+
+#endif // PARALLEL_SCANNER_H
@@ -1,8 +1,73 @@
 #include "parser.h"
+#include <array>
+#include <charconv>
+#include <cmath>
 namespace lox {
-Parser::Parser(const std::vector<Token> &tokens) : tokens(tokens), current(0) {}
+// numbers print in plain decimal with at least one fractional digit, using
+// the shortest digits that read back as the same double: 1e24 prints as
+// 1000000000000000000000000.0, not as the double's exact expansion
+std::string format_literal(Value value)
+{
+    if(!value.is_number() || !std::isfinite(value.as_number()))
+    {
+        return to_string(value);
+    }
+    char buffer[64];
+    auto [end, written] = std::to_chars(buffer, buffer + sizeof(buffer), value.as_number(), std::chars_format::scientific);
+    if(written != std::errc())
+    {
+        return to_string(value);
+    }
+    std::string_view scientific(buffer, end - buffer);
+    size_t           e        = scientific.find('e');
+    int              exponent = 0;
+    if(e == std::string_view::npos || e + 1 >= scientific.size() ||
+       std::from_chars(scientific.data() + e + 1 + (scientific[e + 1] == '+'), end, exponent).ec != std::errc())
+    {
+        return to_string(value);
+    }
+
+    std::string text;
+    std::string digits;
+    for(char c: scientific.substr(0, e))
+    {
+        if(c == '-')
+        {
+            text += c;
+        }
+        else if(c != '.')
+        {
+            digits += c;
+        }
+    }
+    // the decimal point goes after `point` digits
+    int point = exponent + 1;
+    if(point <= 0)
+    {
+        text += "0." + std::string(-point, '0') + digits;
+    }
+    else if(static_cast<size_t>(point) >= digits.size())
+    {
+        text += digits + std::string(point - digits.size(), '0') + ".0";
+    }
+    else
+    {
+        text += digits.substr(0, point) + "." + digits.substr(point);
+    }
+    return text;
+}
+
+Parser::Parser(std::span<const Token> tokens, Arena &arena, Heap &heap, Diagnostics &diagnostics)
+    : arena(arena), heap(heap), diagnostics(diagnostics), tokens(tokens), current(0)
+{
+}
 
-std::shared_ptr<Expression> Parser::parse()
+Parser::Parser(Scanner &scanner, Arena &arena, Heap &heap, Diagnostics &diagnostics)
+    : arena(arena), heap(heap), diagnostics(diagnostics), current(0), stream(&scanner), lookahead(scanner.next_token())
+{
+}
+
+Expression *Parser::parse()
 {
     try
     {
@@ -14,118 +79,193 @@ std::shared_ptr<Expression> Parser::parse()
     }
 }
 
-std::shared_ptr<Expression> Parser::expression()
+bool Parser::parse_program(std::vector<Statement *> &statements)
 {
-    return equality();
+    while(!isAtEnd())
+    {
+        if(Statement *statement = declaration())
+        {
+            statements.push_back(statement);
+        }
+    }
+    return !had_error;
 }
 
-std::shared_ptr<Expression> Parser::equality()
+Statement *Parser::declaration()
 {
-    std::shared_ptr<Expression> expr = comparison();
-
-    while(match({TokenType::BANG_EQUAL, TokenType::EQUAL_EQUAL}))
+    try
     {
-        Token                       op    = previous();
-        std::shared_ptr<Expression> right = comparison();
-        expr                              = std::make_shared<Binary>(expr, op, right);
+        if(match(TokenType::VAR)) return var_declaration();
+        return statement();
+    }
+    catch(const std::runtime_error &e)
+    {
+        synchronize();
+        return nullptr;
     }
-
-    return expr;
 }
 
-std::shared_ptr<Expression> Parser::comparison()
+Statement *Parser::var_declaration()
 {
-    std::shared_ptr<Expression> expr = term();
+    Token       name        = consume(TokenType::IDENTIFIER, "Expect variable name.");
+    Expression *initializer = nullptr;
+    if(match(TokenType::EQUAL))
+    {
+        initializer = expression();
+    }
+    consume(TokenType::SEMICOLON, "Expect ';' after variable declaration.");
+    return arena.make<VarStatement>(name, heap.intern(name.lexeme), initializer);
+}
 
-    while(match({TokenType::GREATER,
-                 TokenType::GREATER_EQUAL,
-                 TokenType::LESS,
-                 TokenType::LESS_EQUAL}))
+Statement *Parser::statement()
+{
+    if(match(TokenType::PRINT))
     {
-        Token                       op    = previous();
-        std::shared_ptr<Expression> right = term();
-        expr                              = std::make_shared<Binary>(expr, op, right);
+        int         line  = previous().line;
+        Expression *value = expression();
+        consume(TokenType::SEMICOLON, "Expect ';' after value.");
+        return arena.make<PrintStatement>(line, value);
     }
 
-    return expr;
+    int         line = peek().line;
+    Expression *expr = expression();
+    consume(TokenType::SEMICOLON, "Expect ';' after expression.");
+    return arena.make<ExpressionStatement>(line, expr);
 }
 
-std::shared_ptr<Expression> Parser::term()
+// skips to the start of the next statement after a syntax error
+void Parser::synchronize()
 {
-    std::shared_ptr<Expression> expr = factor();
-
-    while(match({TokenType::MINUS, TokenType::PLUS}))
+    while(!isAtEnd())
     {
-        Token                       op    = previous();
-        std::shared_ptr<Expression> right = factor();
-        expr                              = std::make_shared<Binary>(expr, op, right);
+        if(advance().type == TokenType::SEMICOLON) return;
+        switch(peek().type)
+        {
+        case TokenType::CLASS:
+        case TokenType::FUN:
+        case TokenType::VAR:
+        case TokenType::FOR:
+        case TokenType::IF:
+        case TokenType::WHILE:
+        case TokenType::PRINT:
+        case TokenType::RETURN: return;
+        default:                break;
+        }
     }
+}
 
-    return expr;
+namespace {
+// binding power of every token type when it follows an operand. tokens that
+// cannot continue an expression stay at PREC_NONE, which ends the loop in
+// parse_precedence(); assignment is right-associative, everything else left.
+// `and` and `or` are not here yet: they need a node that short-circuits in
+// the tree walker and jumps in the VM, not just a binding power
+constexpr std::array<Precedence, END_OF_FILE + 1> infix_precedence = [] {
+    std::array<Precedence, END_OF_FILE + 1> table{};
+    table[TokenType::EQUAL]         = PREC_ASSIGNMENT;
+    table[TokenType::EQUAL_EQUAL]   = PREC_EQUALITY;
+    table[TokenType::BANG_EQUAL]    = PREC_EQUALITY;
+    table[TokenType::GREATER]       = PREC_COMPARISON;
+    table[TokenType::GREATER_EQUAL] = PREC_COMPARISON;
+    table[TokenType::LESS]          = PREC_COMPARISON;
+    table[TokenType::LESS_EQUAL]    = PREC_COMPARISON;
+    table[TokenType::PLUS]          = PREC_TERM;
+    table[TokenType::MINUS]         = PREC_TERM;
+    table[TokenType::STAR]          = PREC_FACTOR;
+    table[TokenType::SLASH]         = PREC_FACTOR;
+    return table;
+}();
+
+static_assert(infix_precedence[TokenType::END_OF_FILE] == PREC_NONE);
+} // namespace
+
+Expression *Parser::expression()
+{
+    return parse_precedence(PREC_ASSIGNMENT);
 }
 
-std::shared_ptr<Expression> Parser::factor()
+// parses an operand, then keeps folding in infix operators that bind at
+// least as tightly as `precedence`
+Expression *Parser::parse_precedence(Precedence precedence)
 {
-    std::shared_ptr<Expression> expr = unary();
+    Expression *expr = unary();
 
-    while(match({TokenType::SLASH, TokenType::STAR}))
+    for(;;)
     {
-        Token                       op    = previous();
-        std::shared_ptr<Expression> right = unary();
-        expr                              = std::make_shared<Binary>(expr, op, right);
+        Precedence infix = infix_precedence[peek().type];
+        if(infix == PREC_NONE || infix < precedence) break;
+        Token op = advance();
+
+        if(op.type == TokenType::EQUAL)
+        {
+            // right-associative: a = b = c assigns c to b, then the result to a
+            Expression *value = parse_precedence(PREC_ASSIGNMENT);
+            if(auto variable = dynamic_cast<Variable *>(expr))
+            {
+                expr = arena.make<Assign>(variable->name, variable->symbol, value);
+            }
+            else
+            {
+                report(op.line, " at '='", "Invalid assignment target.");
+            }
+            continue;
+        }
+
+        Expression *right = parse_precedence(static_cast<Precedence>(infix + 1));
+        expr              = arena.make<Binary>(expr, op, right);
     }
 
     return expr;
 }
 
-std::shared_ptr<Expression> Parser::unary()
+Expression *Parser::unary()
 {
-    if(match({TokenType::BANG, TokenType::MINUS}))
+    if(match(TokenType::BANG, TokenType::MINUS))
     {
-        Token                       op    = previous();
-        std::shared_ptr<Expression> right = unary();
-        return std::make_shared<Unary>(op, right);
+        Token       op    = previous();
+        Expression *right = parse_precedence(PREC_UNARY);
+        return arena.make<Unary>(op, right);
     }
 
     return primary();
 }
 
-std::shared_ptr<Expression> Parser::primary()
+Expression *Parser::primary()
 {
-    if(match({TokenType::FALSE})) return std::make_shared<Literal>("false");
-    if(match({TokenType::TRUE})) return std::make_shared<Literal>("true");
-    if(match({TokenType::NIL})) return std::make_shared<Literal>("nil");
-
-    if(match({TokenType::NUMBER, TokenType::STRING, TokenType::LITERAL}))
+    switch(peek().type)
+    {
+    case TokenType::FALSE: advance(); return arena.make<Literal>(Value::boolean(false));
+    case TokenType::TRUE:  advance(); return arena.make<Literal>(Value::boolean(true));
+    case TokenType::NIL:   advance(); return arena.make<Literal>(Value::nil());
+    case TokenType::NUMBER:
+        return arena.make<Literal>(Value::number(advance().number));
+    case TokenType::STRING:
     {
-        auto retVal       = std::make_shared<Literal>(previous().literal);
-        retVal->getstring = previous().type != TokenType::NUMBER;
-        return retVal;
+        std::string_view text = advance().lexeme;
+        return arena.make<Literal>(Value::string(heap.intern(text.substr(1, text.size() - 2))));
     }
-
-    if(match({TokenType::LEFT_PAREN}))
+    case TokenType::LITERAL:
+        return arena.make<Literal>(Value::string(heap.intern(advance().lexeme)));
+    case TokenType::IDENTIFIER:
+    {
+        const Token &name = advance();
+        return arena.make<Variable>(name, heap.intern(name.lexeme));
+    }
+    case TokenType::LEFT_PAREN:
     {
-        std::shared_ptr<Expression> expr = expression();
+        advance();
+        Expression *expr = expression();
         consume(TokenType::RIGHT_PAREN, "Expect ')' after expression.");
-        return std::make_shared<Grouping>(expr);
+        return arena.make<Grouping>(expr);
+    }
+    default:
+        break;
     }
 
+    error(peek(), "Expect expression.");
     throw std::runtime_error("Expect expression.");
 }
 
-bool Parser::match(const std::vector<TokenType> &types)
-{
-    for(TokenType type: types)
-    {
-        if(check(type))
-        {
-            advance();
-            return true;
-        }
-    }
-    return false;
-}
-
 bool Parser::check(TokenType type)
 {
     if(isAtEnd()) return false;
@@ -137,23 +277,34 @@ bool Parser::isAtEnd()
     return peek().type == TokenType::END_OF_FILE;
 }
 
-Token Parser::advance()
+const Token &Parser::advance()
 {
-    if(!isAtEnd()) current++;
+    if(!isAtEnd())
+    {
+        if(stream)
+        {
+            last      = lookahead;
+            lookahead = stream->next_token();
+        }
+        else
+        {
+            current++;
+        }
+    }
     return previous();
 }
 
-Token Parser::peek()
+const Token &Parser::peek()
 {
-    return tokens[current];
+    return stream ? lookahead : tokens[current];
 }
 
-Token Parser::previous()
+const Token &Parser::previous()
 {
-    return tokens[current - 1];
+    return stream ? last : tokens[current - 1];
 }
 
-Token Parser::consume(TokenType type, const std::string &message)
+const Token &Parser::consume(TokenType type, const std::string &message)
 {
     if(check(type)) return advance();
     error(peek(), message);
@@ -168,12 +319,13 @@ void Parser::error(const Token &token, const std::string &message)
     }
     else
     {
-        report(token.line, " at '" + token.lexeme + "'", message);
+        report(token.line, " at '" + std::string(token.lexeme) + "'", message);
     }
 }
 
 void Parser::report(int line, const std::string &where, const std::string &message)
 {
-    // std::cerr << "[line " << line << "] Error" << where << ": " << message << std::endl;
+    diagnostics.error(line, where, message);
+    had_error = true;
 }
 } // namespace lox
\ No newline at end of file
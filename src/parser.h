@@ -1,28 +1,33 @@
 #ifndef PARSER_H
 #define PARSER_H
 
+#include "arena.h"
+#include "diagnostics.h"
+#include "resolver.h"
 #include "scanner.h"
+#include "value.h"
+#include <span>
 #include <vector>
 #include <string>
-#include <memory>
 #include <iostream>
 #include <sstream>
-#include <variant>
 
 namespace lox {
-using EvalResult = std::variant<double, bool, std::string>;
-
+// how parse prints a literal: numbers always carry a fractional part
+std::string format_literal(Value value);
 
+// AST nodes live in an Arena and are released all at once with it, so the
+// hierarchy deliberately has no virtual destructor
 class Expression
 {
   public:
-    virtual ~Expression() = default;
     virtual std::string form_string()
     {
         return "";
     }
-    virtual EvalResult evaluate() = 0;
-    bool               getstring  = false;
+    // strings produced while evaluating are allocated in `heap`; resolved
+    // variables are read from `globals`
+    virtual Value evaluate(Heap &heap, Globals &globals) = 0;
   protected:
   private:
 };
@@ -30,258 +35,320 @@ class Expression
 class Binary : public Expression
 {
   public:
-    std::shared_ptr<Expression> left;
-    Token                       op;
-    std::shared_ptr<Expression> right;
+    Expression *left;
+    TokenType   op;
+    int         line;
+    Expression *right;
 
-    Binary(std::shared_ptr<Expression> left, Token op, std::shared_ptr<Expression> right)
-        : left(left), op(op), right(right)
+    Binary(Expression *left, const Token &op, Expression *right)
+        : left(left), op(op.type), line(op.line), right(right)
     {
     }
     virtual std::string form_string() override
     {
         std::stringstream ss;
         ss << "(";
-        if(tokenident.find(op.type) != tokenident.end())
+        if(is_symbol_token(op))
         {
-            ss << tokenident.at(op.type).second << " ";
+            ss << token_symbol(op) << " ";
         }
         ss << left->form_string() << " " << right->form_string() + ")";
         return ss.str();
     }
 
-    EvalResult evaluate() override
+    Value evaluate(Heap &heap, Globals &globals) override
     {
-        EvalResult left_result     = left->evaluate();
-        EvalResult right_result    = right->evaluate();
-        bool       are_both_double = std::holds_alternative<double>(left_result) &&
-                               std::holds_alternative<double>(right_result);
-        bool are_both_boolean = std::holds_alternative<bool>(left_result) &&
-                                std::holds_alternative<bool>(right_result);
-
-        ErrorInScanner error;
-        if(op.type == TokenType::GREATER)
-        {
-            if(are_both_double)
-                return std::get<double>(left_result) > std::get<double>(right_result);
-        }
-        else if(op.type == TokenType::GREATER_EQUAL)
-        {
-            if(are_both_double)
-                return std::get<double>(left_result) >= std::get<double>(right_result);
-        }
-        else if(op.type == TokenType::LESS)
-        {
-            if(are_both_double)
-                return std::get<double>(left_result) < std::get<double>(right_result);
-        }
-        else if(op.type == TokenType::LESS_EQUAL)
-        {
-            if(are_both_double)
-                return std::get<double>(left_result) <= std::get<double>(right_result);
-        }
-        else if(op.type == TokenType::EQUAL_EQUAL)
+        Value left_result     = left->evaluate(heap, globals);
+        Value right_result    = right->evaluate(heap, globals);
+        bool  are_both_double = left_result.is_number() && right_result.is_number();
+
+        if(op == TokenType::EQUAL_EQUAL)
         {
-            return are_both_double
-                       ? std::get<double>(left_result) == std::get<double>(right_result)
-                       : (!are_both_boolean ? (evaluateWithStringFlag(left) ==
-                                               evaluateWithStringFlag(right))
-                                            : std::get<bool>(left_result) ==
-                                                  std::get<bool>(right_result));
+            return Value::boolean(left_result == right_result);
         }
-        else if(op.type == TokenType::BANG_EQUAL)
+        else if(op == TokenType::BANG_EQUAL)
         {
-            return are_both_double
-                       ? std::get<double>(left_result) != std::get<double>(right_result)
-                       : (!are_both_boolean ? (evaluateWithStringFlag(left) !=
-                                               evaluateWithStringFlag(right))
-                                            : std::get<bool>(left_result) !=
-                                                  std::get<bool>(right_result));
+            return Value::boolean(!(left_result == right_result));
         }
-        else if(op.type == TokenType::PLUS)
+        else if(op == TokenType::PLUS)
         {
             if(are_both_double)
-                return std::get<double>(left_result) + std::get<double>(right_result);
+                return Value::number(left_result.as_number() + right_result.as_number());
 
-            if(std::holds_alternative<std::string>(left_result) &&
-               std::holds_alternative<std::string>(right_result))
+            if(left_result.is_string() && right_result.is_string())
             {
-                return std::get<std::string>(left_result) +
-                       std::get<std::string>(right_result);
+                return Value::string(heap.concatenate(left_result.as_string(), right_result.as_string()));
             }
-            error.add_error("Operands must be two numbers or two strings.");
+            throw RuntimeError(line, "Operands must be two numbers or two strings.");
         }
-        else if(op.type == TokenType::AND)
+
+        if(!are_both_double)
         {
-            if(std::holds_alternative<bool>(left_result) &&
-               std::holds_alternative<bool>(right_result))
-            {
-                return std::get<bool>(left_result) && std::get<bool>(right_result);
-            }
-            error.add_error("Operands must be two booleans.");
+            throw RuntimeError(line, "Operands must be numbers.");
         }
-        else if(op.type == TokenType::OR)
+        double left_val  = left_result.as_number();
+        double right_val = right_result.as_number();
+        switch(op)
         {
-            if(std::holds_alternative<bool>(left_result) &&
-               std::holds_alternative<bool>(right_result))
-            {
-                return std::get<bool>(left_result) || std::get<bool>(right_result);
-            }
-            error.add_error("Operands must be two booleans.");
+        case TokenType::GREATER:       return Value::boolean(left_val > right_val);
+        case TokenType::GREATER_EQUAL: return Value::boolean(left_val >= right_val);
+        case TokenType::LESS:          return Value::boolean(left_val < right_val);
+        case TokenType::LESS_EQUAL:    return Value::boolean(left_val <= right_val);
+        case TokenType::MINUS:         return Value::number(left_val - right_val);
+        case TokenType::STAR:          return Value::number(left_val * right_val);
+        case TokenType::SLASH:         return Value::number(left_val / right_val);
+        default:                       return Value::number(0.0);
         }
-        else if(are_both_double)
-        {
-            double left_val  = std::get<double>(left_result);
-            double right_val = std::get<double>(right_result);
-            return (op.type == TokenType::MINUS
-                        ? left_val - right_val
-                        : (op.type == TokenType::STAR
-                               ? left_val * right_val
-                               : (op.type == TokenType::SLASH ? left_val / right_val : 0.0)));
-        }
-        error.set_retvalue(70);
-        return "";
-    }
-
-  private:
-    std::string evaluateWithStringFlag(std::shared_ptr<Expression> expr,
-                                       bool                        flag = true) const
-    {
-        bool oldFlag      = expr->getstring;
-        expr->getstring   = flag;
-        EvalResult result = expr->evaluate();
-        expr->getstring   = oldFlag;
-        return std::get<std::string>(result);
     }
 };
 
 class Unary : public Expression
 {
   public:
-    Token                       op;
-    std::shared_ptr<Expression> right;
+    TokenType   op;
+    int         line;
+    Expression *right;
 
-    Unary(Token op, std::shared_ptr<Expression> right) : op(op), right(right) {}
+    Unary(const Token &op, Expression *right) : op(op.type), line(op.line), right(right) {}
     virtual std::string form_string() override
     {
         std::stringstream ss;
         ss << "(";
-        if(tokenident.find(op.type) != tokenident.end())
+        if(is_symbol_token(op))
         {
-            ss << tokenident.at(op.type).second << " ";
+            ss << token_symbol(op) << " ";
         }
         ss << right->form_string() + ")";
         return ss.str();
     }
 
-    EvalResult evaluate() override
+    Value evaluate(Heap &heap, Globals &globals) override
     {
-        EvalResult right_result = right->evaluate();
+        Value right_result = right->evaluate(heap, globals);
 
-        if(std::holds_alternative<bool>(right_result))
+        if(op == TokenType::BANG)
         {
-            if(op.type == TokenType::BANG) return !std::get<bool>(right_result);
+            return Value::boolean(right_result.is_falsey());
         }
-        else if(std::holds_alternative<double>(right_result))
+        if(right_result.is_number())
         {
-            if(op.type == TokenType::MINUS) return -std::get<double>(right_result);
-            return false;
+            return Value::number(-right_result.as_number());
         }
-        else if(std::holds_alternative<std::string>(right_result))
-        {
-            if(op.type == TokenType::BANG) return (std::get<std::string>(right_result) == "nil");
-        }
-        ErrorInScanner error;
-        error.add_error("Operand must be a number.");
-        error.set_retvalue(70);
-        return "";
+        throw RuntimeError(line, "Operand must be a number.");
     }
 };
 
+// literal values are decoded once by the parser
 class Literal : public Expression
 {
   public:
-    std::string value;
+    Value value;
 
-    Literal(const std::string &value) : value(value) {}
+    Literal(Value value) : value(value) {}
 
     virtual std::string form_string() override
+    {
+        return format_literal(value);
+    }
+
+    Value evaluate(Heap & /*heap*/, Globals & /*globals*/) override
     {
         return value;
     }
+};
 
-    EvalResult evaluate() override
+class Grouping : public Expression
+{
+  public:
+    Expression *expression;
+
+    Grouping(Expression *expression) : expression(expression) {}
+    virtual std::string form_string() override
     {
-        if(value == "true")
-        {
-            return true;
-        }
-        else if(value == "false")
+        return "(group " + expression->form_string() + ")";
+    }
+
+    Value evaluate(Heap &heap, Globals &globals) override
+    {
+        return expression->evaluate(heap, globals);
+    }
+};
+
+class Variable : public Expression
+{
+  public:
+    Token            name;
+    const ObjString *symbol;
+    int              slot = Resolver::UNRESOLVED;
+
+    Variable(Token name, const ObjString *symbol) : name(name), symbol(symbol) {}
+    virtual std::string form_string() override
+    {
+        return std::string(name.lexeme);
+    }
+
+    Value evaluate(Heap & /*heap*/, Globals &globals) override
+    {
+        if(globals.is_defined(slot))
         {
-            return false;
+            return globals.get(slot);
         }
-        else
+        throw RuntimeError(name.line, "Undefined variable '" + std::string(name.lexeme) + "'.");
+    }
+};
+
+// `name = value`; assignment is an expression whose result is `value`
+class Assign : public Expression
+{
+  public:
+    Token            name;
+    const ObjString *symbol;
+    int              slot = Resolver::UNRESOLVED;
+    Expression      *value;
+
+    Assign(Token name, const ObjString *symbol, Expression *value) : name(name), symbol(symbol), value(value) {}
+    virtual std::string form_string() override
+    {
+        return "(= " + std::string(name.lexeme) + " " + value->form_string() + ")";
+    }
+
+    Value evaluate(Heap &heap, Globals &globals) override
+    {
+        Value result = value->evaluate(heap, globals);
+        if(globals.is_defined(slot))
         {
-            if(getstring)
-            {
-                return value;
-            }
-            try
-            {
-                return std::stod(value);
-            }
-            catch(const std::exception &e)
-            {
-                return value;
-            }
+            globals.set(slot, result);
+            return result;
         }
+        throw RuntimeError(name.line, "Undefined variable '" + std::string(name.lexeme) + "'.");
     }
 };
 
-class Grouping : public Expression
+// statements of a program, allocated in the same Arena as their expressions
+class Statement
 {
   public:
-    std::shared_ptr<Expression> expression;
+    int line;
 
-    Grouping(std::shared_ptr<Expression> expression) : expression(expression) {}
-    virtual std::string form_string() override
+    Statement(int line) : line(line) {}
+    // program output, i.e. print, goes to `out`
+    virtual void execute(Heap &heap, Globals &globals, std::ostream &out) = 0;
+};
+
+class PrintStatement : public Statement
+{
+  public:
+    Expression *expression;
+
+    PrintStatement(int line, Expression *expression) : Statement(line), expression(expression) {}
+    void execute(Heap &heap, Globals &globals, std::ostream &out) override
     {
-        return "(group " + expression->form_string() + ")";
+        out << expression->evaluate(heap, globals) << '\n';
     }
+};
 
-    EvalResult evaluate() override
+class ExpressionStatement : public Statement
+{
+  public:
+    Expression *expression;
+
+    ExpressionStatement(int line, Expression *expression) : Statement(line), expression(expression) {}
+    void execute(Heap &heap, Globals &globals, std::ostream & /*out*/) override
     {
-        return expression->evaluate();
+        expression->evaluate(heap, globals);
     }
 };
 
+// `var name;` or `var name = initializer;`
+class VarStatement : public Statement
+{
+  public:
+    Token            name;
+    const ObjString *symbol;
+    int              slot = Resolver::UNRESOLVED;
+    Expression      *initializer;
+
+    VarStatement(Token name, const ObjString *symbol, Expression *initializer)
+        : Statement(name.line), name(name), symbol(symbol), initializer(initializer)
+    {
+    }
+    void execute(Heap &heap, Globals &globals, std::ostream & /*out*/) override
+    {
+        globals.define(slot, initializer ? initializer->evaluate(heap, globals) : Value::nil());
+    }
+};
+
+// binding power of infix operators, weakest first
+enum Precedence
+{
+    PREC_NONE,
+    PREC_ASSIGNMENT, // =
+    PREC_OR,         // or
+    PREC_AND,        // and
+    PREC_EQUALITY,   // == !=
+    PREC_COMPARISON, // < > <= >=
+    PREC_TERM,       // + -
+    PREC_FACTOR,     // * /
+    PREC_UNARY,      // ! -
+    PREC_CALL,       // . ()
+    PREC_PRIMARY
+};
+
 class Parser
 {
   public:
-    Parser(const std::vector<Token> &tokens);
-    std::shared_ptr<Expression> parse();
+    // identifiers and string literals are interned in `heap` and syntax
+    // errors are reported to `diagnostics`
+    // parses a token sequence ending in END_OF_FILE without copying it;
+    // the tokens must outlive the parser
+    Parser(std::span<const Token> tokens, Arena &arena, Heap &heap, Diagnostics &diagnostics);
+    // pulls tokens from the scanner as it goes, keeping only one token of
+    // lookahead and the previously consumed token
+    Parser(Scanner &scanner, Arena &arena, Heap &heap, Diagnostics &diagnostics);
+    // the returned tree is owned by the arena passed to the constructor
+    Expression *parse();
+    // parses declarations and statements up to the end of the input.
+    // syntax errors are reported and skipped so later ones are found too;
+    // returns false if there were any
+    bool        parse_program(std::vector<Statement *> &statements);
 
   private:
-    std::vector<Token> tokens;
-    int                current;
-
-    std::shared_ptr<Expression> expression();
-    std::shared_ptr<Expression> equality();
-    std::shared_ptr<Expression> comparison();
-    std::shared_ptr<Expression> term();
-    std::shared_ptr<Expression> factor();
-    std::shared_ptr<Expression> unary();
-    std::shared_ptr<Expression> primary();
-
-    bool  match(const std::vector<TokenType> &types);
-    bool  check(TokenType type);
-    bool  isAtEnd();
-    Token advance();
-    Token peek();
-    Token previous();
-    Token consume(TokenType type, const std::string &message);
-    void  error(const Token &token, const std::string &message);
-    void  report(int line, const std::string &where, const std::string &message);
+    Arena                 &arena;
+    Heap                  &heap;
+    Diagnostics           &diagnostics;
+    std::span<const Token> tokens;
+    size_t                 current;
+    Scanner               *stream = nullptr;
+    Token                  last{TokenType::END_OF_FILE, "", 0};
+    Token                  lookahead{TokenType::END_OF_FILE, "", 0};
+    bool                   had_error = false;
+
+    Statement  *declaration();
+    Statement  *var_declaration();
+    Statement  *statement();
+    void        synchronize();
+
+    Expression *expression();
+    Expression *parse_precedence(Precedence precedence);
+    Expression *unary();
+    Expression *primary();
+
+    // consumes the next token if it is any of `types`
+    template <typename... Types> bool match(Types... types)
+    {
+        if(!(check(types) || ...)) return false;
+        advance();
+        return true;
+    }
+    bool check(TokenType type);
+    bool isAtEnd();
+    // the returned references stay valid until the next advance()
+    const Token &advance();
+    const Token &peek();
+    const Token &previous();
+    const Token &consume(TokenType type, const std::string &message);
+    void         error(const Token &token, const std::string &message);
+    void         report(int line, const std::string &where, const std::string &message);
 };
 } // namespace lox
 
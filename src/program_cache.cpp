@@ -0,0 +1,341 @@
+#include "program_cache.h"
+#include "source.h"
+#include <cerrno>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <type_traits>
+#include <unistd.h>
+
+#ifndef LOX_VERSION
+#define LOX_VERSION "unknown"
+#endif
+#ifndef LOX_COMPILER_FINGERPRINT
+#define LOX_COMPILER_FINGERPRINT "unknown"
+#endif
+
+namespace lox {
+namespace {
+// a cache file is this header followed by `payload_size` bytes:
+//
+//   source          source_size bytes, the program's text
+//   code            code_size bytes
+//   lines           line_count (u64 offset, i32 line) pairs
+//   statement_ends  end_count u64 offsets
+//   constants       constant_count of a tag byte, then 8 bytes of double
+//                   for numbers or a u32 length and the bytes for strings
+//   globals         global_count of a u32 length and the name's bytes
+//
+// integers are in host byte order, which the key covers along with the
+// interpreter and format versions and a fingerprint of the compiler's
+// sources. the key only names the file: an entry is used only when its
+// source is byte for byte the one being loaded
+struct Header
+{
+    char     magic[4];
+    uint32_t format;
+    uint64_t key;
+    uint64_t source_size;
+    uint64_t code_size;
+    uint64_t line_count;
+    uint64_t end_count;
+    uint64_t constant_count;
+    uint64_t global_count;
+    uint64_t payload_size;
+    uint64_t checksum;
+};
+
+static_assert(std::is_trivially_copyable_v<Header>);
+
+constexpr char MAGIC[4] = {'L', 'O', 'X', 'C'};
+
+enum ConstantTag : uint8_t
+{
+    TAG_NIL,
+    TAG_FALSE,
+    TAG_TRUE,
+    TAG_NUMBER,
+    TAG_STRING
+};
+
+// FNV-1a over 8-byte words, so hashing a large source or payload costs about
+// as much as reading it
+uint64_t hash_bytes(const char *data, size_t size, uint64_t hash = 14695981039346656037ull)
+{
+    constexpr uint64_t PRIME = 1099511628211ull;
+    for(; size >= 8; data += 8, size -= 8)
+    {
+        uint64_t word;
+        std::memcpy(&word, data, 8);
+        hash = (hash ^ word) * PRIME;
+    }
+    for(; size > 0; data++, size--)
+    {
+        hash = (hash ^ static_cast<unsigned char>(*data)) * PRIME;
+    }
+    return hash;
+}
+
+uint64_t cache_key(std::string_view source)
+{
+    static const std::string salt = [] {
+        uint32_t    order = 0x01020304;
+        std::string salt  = "lox " LOX_VERSION " compiler " LOX_COMPILER_FINGERPRINT " format " +
+                           std::to_string(ProgramCache::FORMAT_VERSION) + " order ";
+        salt.append(reinterpret_cast<const char *>(&order), sizeof order);
+        return salt;
+    }();
+    return hash_bytes(source.data(), source.size(), hash_bytes(salt.data(), salt.size()));
+}
+
+template <typename T> void put(std::string &out, T value)
+{
+    out.append(reinterpret_cast<const char *>(&value), sizeof value);
+}
+
+void put_string(std::string &out, std::string_view chars)
+{
+    put(out, static_cast<uint32_t>(chars.size()));
+    out.append(chars);
+}
+
+// bounds-checked cursor over the payload; once a read runs past the end
+// every later read fails too
+class Reader
+{
+  public:
+    Reader(const char *begin, const char *end) : cursor(begin), end(end) {}
+
+    template <typename T> bool get(T &value)
+    {
+        if(static_cast<size_t>(end - cursor) < sizeof value) return fail();
+        std::memcpy(&value, cursor, sizeof value);
+        cursor += sizeof value;
+        return true;
+    }
+    bool get_bytes(size_t size, std::string_view &bytes)
+    {
+        if(static_cast<size_t>(end - cursor) < size) return fail();
+        bytes = std::string_view(cursor, size);
+        cursor += size;
+        return true;
+    }
+    bool get_string(std::string_view &chars)
+    {
+        uint32_t size;
+        return get(size) && get_bytes(size, chars);
+    }
+    bool at_end() const
+    {
+        return cursor == end;
+    }
+
+  private:
+    bool fail()
+    {
+        cursor = end = nullptr;
+        return false;
+    }
+
+    const char *cursor;
+    const char *end;
+};
+
+// every opcode is known and every operand indexes the constant pool or the
+// global names, so the VM never reads out of bounds
+bool valid_code(const Chunk &chunk)
+{
+    const std::vector<uint8_t> &code = chunk.code;
+    if(code.empty() || code.back() != OP_RETURN) return false;
+    for(size_t offset = 0; offset < code.size();)
+    {
+        uint8_t op = code[offset++];
+        size_t  limit;
+        switch(op)
+        {
+        case OP_CONSTANT:
+            limit = chunk.constants.size();
+            break;
+        case OP_GET_GLOBAL:
+        case OP_DEFINE_GLOBAL:
+        case OP_SET_GLOBAL:
+            limit = chunk.globals.size();
+            break;
+        default:
+            if(op > OP_RETURN) return false;
+            continue;
+        }
+        if(code.size() - offset < Chunk::OPERAND_SIZE || chunk.read_operand(offset) >= limit) return false;
+        offset += Chunk::OPERAND_SIZE;
+    }
+    return true;
+}
+} // namespace
+
+bool ProgramCache::load(std::string_view source, Chunk &chunk, Heap &heap) const
+{
+    uint64_t     key = cache_key(source);
+    SourceBuffer file;
+    if(!file.load(path_for(key))) return false;
+
+    std::string_view image = file.view();
+    Header           header;
+    if(image.size() < sizeof header) return false;
+    std::memcpy(&header, image.data(), sizeof header);
+    std::string_view payload = image.substr(sizeof header);
+    if(std::memcmp(header.magic, MAGIC, sizeof MAGIC) != 0 || header.format != FORMAT_VERSION || header.key != key ||
+       header.source_size != source.size() || header.payload_size != payload.size() ||
+       header.checksum != hash_bytes(payload.data(), payload.size()))
+    {
+        return false;
+    }
+    // counts are checked against what is left before anything is reserved,
+    // so a bad header cannot ask for absurd allocations
+    if(header.code_size > payload.size() || header.line_count > payload.size() / 12 ||
+       header.end_count > payload.size() / 8 || header.constant_count > payload.size() ||
+       header.global_count > payload.size() / 4)
+    {
+        return false;
+    }
+
+    Reader           reader(payload.data(), payload.data() + payload.size());
+    std::string_view bytes;
+    if(!reader.get_bytes(header.source_size, bytes) || bytes != source) return false;
+    if(!reader.get_bytes(header.code_size, bytes)) return false;
+    chunk.code.assign(bytes.begin(), bytes.end());
+
+    chunk.lines.reserve(header.line_count);
+    for(uint64_t i = 0; i < header.line_count; i++)
+    {
+        uint64_t offset;
+        int32_t  line;
+        if(!reader.get(offset) || !reader.get(line)) return false;
+        chunk.lines.push_back({static_cast<size_t>(offset), line});
+    }
+    chunk.statement_ends.reserve(header.end_count);
+    for(uint64_t i = 0; i < header.end_count; i++)
+    {
+        uint64_t offset;
+        if(!reader.get(offset)) return false;
+        chunk.statement_ends.push_back(static_cast<size_t>(offset));
+    }
+
+    chunk.constants.reserve(header.constant_count);
+    for(uint64_t i = 0; i < header.constant_count; i++)
+    {
+        uint8_t tag;
+        if(!reader.get(tag)) return false;
+        switch(tag)
+        {
+        case TAG_NIL:   chunk.constants.push_back(Value::nil()); break;
+        case TAG_FALSE: chunk.constants.push_back(Value::boolean(false)); break;
+        case TAG_TRUE:  chunk.constants.push_back(Value::boolean(true)); break;
+        case TAG_NUMBER:
+        {
+            double number;
+            if(!reader.get(number)) return false;
+            chunk.constants.push_back(Value::number(number));
+            break;
+        }
+        case TAG_STRING:
+            if(!reader.get_string(bytes)) return false;
+            chunk.constants.push_back(Value::string(heap.intern(bytes)));
+            break;
+        default:
+            return false;
+        }
+    }
+    chunk.globals.reserve(header.global_count);
+    for(uint64_t i = 0; i < header.global_count; i++)
+    {
+        if(!reader.get_string(bytes)) return false;
+        chunk.globals.push_back(heap.intern(bytes));
+    }
+    return reader.at_end() && valid_code(chunk);
+}
+
+bool ProgramCache::store(std::string_view source, const Chunk &chunk) const
+{
+    std::string payload(source);
+    payload.append(reinterpret_cast<const char *>(chunk.code.data()), chunk.code.size());
+    for(const Chunk::LineStart &start: chunk.lines)
+    {
+        put(payload, static_cast<uint64_t>(start.offset));
+        put(payload, static_cast<int32_t>(start.line));
+    }
+    for(size_t end: chunk.statement_ends)
+    {
+        put(payload, static_cast<uint64_t>(end));
+    }
+    for(Value constant: chunk.constants)
+    {
+        if(constant.is_number())
+        {
+            put(payload, static_cast<uint8_t>(TAG_NUMBER));
+            put(payload, constant.as_number());
+        }
+        else if(constant.is_string())
+        {
+            put(payload, static_cast<uint8_t>(TAG_STRING));
+            put_string(payload, constant.as_string()->view());
+        }
+        else
+        {
+            uint8_t tag = constant.is_nil() ? TAG_NIL : constant.as_bool() ? TAG_TRUE : TAG_FALSE;
+            put(payload, tag);
+        }
+    }
+    for(const ObjString *name: chunk.globals)
+    {
+        put_string(payload, name->view());
+    }
+
+    Header header{};
+    std::memcpy(header.magic, MAGIC, sizeof MAGIC);
+    header.format         = FORMAT_VERSION;
+    header.key            = cache_key(source);
+    header.source_size    = source.size();
+    header.code_size      = chunk.code.size();
+    header.line_count     = chunk.lines.size();
+    header.end_count      = chunk.statement_ends.size();
+    header.constant_count = chunk.constants.size();
+    header.global_count   = chunk.globals.size();
+    header.payload_size   = payload.size();
+    header.checksum       = hash_bytes(payload.data(), payload.size());
+
+    if(::mkdir(directory.c_str(), 0777) != 0 && errno != EEXIST) return false;
+    // written under a unique name and renamed over the old file, so runs
+    // loading the same program concurrently see either file whole
+    std::string temporary = directory + "/.loxc-XXXXXX";
+    int         fd        = ::mkostemp(temporary.data(), O_CLOEXEC);
+    if(fd < 0) return false;
+    bool written = true;
+    for(std::string_view part: {std::string_view(reinterpret_cast<const char *>(&header), sizeof header),
+                                std::string_view(payload)})
+    {
+        while(written && !part.empty())
+        {
+            ssize_t n = ::write(fd, part.data(), part.size());
+            if(n < 0 && errno == EINTR) continue;
+            written = n > 0;
+            if(written) part.remove_prefix(n);
+        }
+    }
+    written = ::close(fd) == 0 && written;
+    if(!written || std::rename(temporary.c_str(), path_for(header.key).c_str()) != 0)
+    {
+        ::unlink(temporary.c_str());
+        return false;
+    }
+    return true;
+}
+
+std::string ProgramCache::path_for(uint64_t key) const
+{
+    char name[32];
+    std::snprintf(name, sizeof name, "/%016llx.loxc", static_cast<unsigned long long>(key));
+    return directory + name;
+}
+} // namespace lox
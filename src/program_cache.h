@@ -0,0 +1,41 @@
+#ifndef PROGRAM_CACHE_H
+#define PROGRAM_CACHE_H
+
+#include "chunk.h"
+#include "value.h"
+#include <cstdint>
+#include <string>
+#include <string_view>
+
+namespace lox {
+// compiled programs on disk, one file per source in a cache directory. the
+// file name is a hash of the source text, the interpreter version and a
+// fingerprint of the compiler's own sources, so an edited script or a
+// rebuilt compiler simply misses. files are read through a read-only mapping
+// and fully validated (format, key, the complete source text, section
+// bounds, checksum); anything that does not check out is a miss and gets
+// rewritten by the next store(). holds no mutable state, so one cache can be
+// shared by threads
+class ProgramCache
+{
+  public:
+    // bump whenever the layout below or the meaning of the bytecode changes
+    static constexpr uint32_t FORMAT_VERSION = 2;
+
+    explicit ProgramCache(std::string directory) : directory(std::move(directory)) {}
+
+    // fills an empty `chunk` with the cached program for `source`, interning
+    // its strings in `heap`; false on a miss
+    bool load(std::string_view source, Chunk &chunk, Heap &heap) const;
+    // writes `chunk` as the program for `source`, creating the directory if
+    // needed. the file is renamed into place, so readers never see half of it
+    bool store(std::string_view source, const Chunk &chunk) const;
+
+  private:
+    std::string path_for(uint64_t key) const;
+
+    std::string directory;
+};
+} // namespace lox
+
+#endif // PROGRAM_CACHE_H
@@ -0,0 +1,86 @@
+#include "resolver.h"
+#include "parser.h"
+
+namespace lox {
+int Resolver::declare(const ObjString *name)
+{
+    auto [it, inserted] = slots.try_emplace(name, static_cast<int>(slot_names.size()));
+    if(inserted)
+    {
+        slot_names.push_back(name);
+    }
+    return it->second;
+}
+
+void Resolver::resolve(Expression *expr)
+{
+    if(auto binary = dynamic_cast<Binary *>(expr))
+    {
+        resolve(binary->left);
+        resolve(binary->right);
+    }
+    else if(auto unary = dynamic_cast<Unary *>(expr))
+    {
+        resolve(unary->right);
+    }
+    else if(auto grouping = dynamic_cast<Grouping *>(expr))
+    {
+        resolve(grouping->expression);
+    }
+    else if(auto variable = dynamic_cast<Variable *>(expr))
+    {
+        variable->slot = declare(variable->symbol);
+    }
+    else if(auto assign = dynamic_cast<Assign *>(expr))
+    {
+        resolve(assign->value);
+        assign->slot = declare(assign->symbol);
+    }
+}
+
+void Resolver::resolve(Statement *statement)
+{
+    if(auto print = dynamic_cast<PrintStatement *>(statement))
+    {
+        resolve(print->expression);
+    }
+    else if(auto expression = dynamic_cast<ExpressionStatement *>(statement))
+    {
+        resolve(expression->expression);
+    }
+    else if(auto var = dynamic_cast<VarStatement *>(statement))
+    {
+        if(var->initializer)
+        {
+            resolve(var->initializer);
+        }
+        var->slot = declare(var->symbol);
+    }
+}
+
+size_t Resolver::slot_count() const
+{
+    return slot_names.size();
+}
+
+const std::vector<const ObjString *> &Resolver::names() const
+{
+    return slot_names;
+}
+
+void Globals::define(int slot, Value value)
+{
+    reserve(slot + 1);
+    values[slot]  = value;
+    defined[slot] = true;
+}
+
+void Globals::reserve(size_t count)
+{
+    if(values.size() < count)
+    {
+        values.resize(count);
+        defined.resize(count, false);
+    }
+}
+} // namespace lox
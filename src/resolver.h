@@ -0,0 +1,60 @@
+#ifndef RESOLVER_H
+#define RESOLVER_H
+
+#include "value.h"
+#include <cstddef>
+#include <vector>
+
+namespace lox {
+class Expression;
+class Statement;
+
+// binds variables to fixed slots ahead of execution. every distinct global
+// name gets the next index the first time it is declared or referenced, so
+// a variable access at runtime is an index into Globals instead of a lookup
+// by name. locals will get stack slots from here once scopes exist
+class Resolver
+{
+  public:
+    static constexpr int UNRESOLVED = -1;
+
+    int  declare(const ObjString *name);
+    // assigns a slot to every variable declared or used in the tree
+    void resolve(Expression *expr);
+    void resolve(Statement *statement);
+
+    size_t                                slot_count() const;
+    const std::vector<const ObjString *> &names() const;
+
+  private:
+    SymbolMap<int>                 slots;
+    std::vector<const ObjString *> slot_names;
+};
+
+// runtime storage for resolved globals. a slot stays undefined until the
+// `var` declaration that owns it runs
+class Globals
+{
+  public:
+    bool is_defined(int slot) const
+    {
+        return slot >= 0 && static_cast<size_t>(slot) < defined.size() && defined[slot];
+    }
+    Value get(int slot) const
+    {
+        return values[slot];
+    }
+    void define(int slot, Value value);
+    void set(int slot, Value value)
+    {
+        values[slot] = value;
+    }
+    void reserve(size_t count);
+
+  private:
+    std::vector<Value> values;
+    std::vector<bool>  defined;
+};
+} // namespace lox
+
+#endif // RESOLVER_H
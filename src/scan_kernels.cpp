@@ -0,0 +1,290 @@
+#include "scan_kernels.h"
+#include <cstdlib>
+
+#if defined(__x86_64__)
+#include <immintrin.h>
+#define LOX_X86_KERNELS 1
+#endif
+
+namespace lox {
+namespace {
+bool is_identifier_char(char c)
+{
+    return (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || (c >= '0' && c <= '9') || c == '.' ||
+           c == '_';
+}
+
+size_t skip_whitespace_scalar(const char *p, size_t n, int &newlines)
+{
+    size_t i = 0;
+    for(; i < n && (p[i] == ' ' || p[i] == '\t' || p[i] == '\n'); i++)
+    {
+        newlines += p[i] == '\n';
+    }
+    return i;
+}
+
+size_t find_line_end_scalar(const char *p, size_t n)
+{
+    size_t i = 0;
+    while(i < n && p[i] != '\n' && p[i] != '\0')
+    {
+        i++;
+    }
+    return i;
+}
+
+size_t find_string_end_scalar(const char *p, size_t n, int &newlines)
+{
+    size_t i = 0;
+    for(; i < n && p[i] != '"' && p[i] != '\0'; i++)
+    {
+        newlines += p[i] == '\n';
+    }
+    return i;
+}
+
+size_t identifier_length_scalar(const char *p, size_t n)
+{
+    size_t i = 0;
+    while(i < n && is_identifier_char(p[i]))
+    {
+        i++;
+    }
+    return i;
+}
+
+#ifdef LOX_X86_KERNELS
+// bits below `index` of a movemask result
+inline unsigned below(unsigned mask, unsigned index)
+{
+    return mask & ((1u << index) - 1);
+}
+
+size_t skip_whitespace_sse2(const char *p, size_t n, int &newlines)
+{
+    const __m128i space = _mm_set1_epi8(' ');
+    const __m128i tab   = _mm_set1_epi8('\t');
+    const __m128i nl    = _mm_set1_epi8('\n');
+    size_t        i     = 0;
+    for(; i + 16 <= n; i += 16)
+    {
+        __m128i  v     = _mm_loadu_si128(reinterpret_cast<const __m128i *>(p + i));
+        __m128i  isnl  = _mm_cmpeq_epi8(v, nl);
+        __m128i  ws    = _mm_or_si128(_mm_or_si128(_mm_cmpeq_epi8(v, space), _mm_cmpeq_epi8(v, tab)), isnl);
+        unsigned nls   = _mm_movemask_epi8(isnl);
+        unsigned other = ~_mm_movemask_epi8(ws) & 0xFFFF;
+        if(other)
+        {
+            unsigned index = __builtin_ctz(other);
+            newlines += __builtin_popcount(below(nls, index));
+            return i + index;
+        }
+        newlines += __builtin_popcount(nls);
+    }
+    return i + skip_whitespace_scalar(p + i, n - i, newlines);
+}
+
+size_t find_line_end_sse2(const char *p, size_t n)
+{
+    const __m128i nl   = _mm_set1_epi8('\n');
+    const __m128i zero = _mm_setzero_si128();
+    size_t        i    = 0;
+    for(; i + 16 <= n; i += 16)
+    {
+        __m128i  v    = _mm_loadu_si128(reinterpret_cast<const __m128i *>(p + i));
+        unsigned hits = _mm_movemask_epi8(_mm_or_si128(_mm_cmpeq_epi8(v, nl), _mm_cmpeq_epi8(v, zero)));
+        if(hits)
+        {
+            return i + __builtin_ctz(hits);
+        }
+    }
+    return i + find_line_end_scalar(p + i, n - i);
+}
+
+size_t find_string_end_sse2(const char *p, size_t n, int &newlines)
+{
+    const __m128i quote = _mm_set1_epi8('"');
+    const __m128i nl    = _mm_set1_epi8('\n');
+    const __m128i zero  = _mm_setzero_si128();
+    size_t        i     = 0;
+    for(; i + 16 <= n; i += 16)
+    {
+        __m128i  v    = _mm_loadu_si128(reinterpret_cast<const __m128i *>(p + i));
+        unsigned nls  = _mm_movemask_epi8(_mm_cmpeq_epi8(v, nl));
+        unsigned hits = _mm_movemask_epi8(_mm_or_si128(_mm_cmpeq_epi8(v, quote), _mm_cmpeq_epi8(v, zero)));
+        if(hits)
+        {
+            unsigned index = __builtin_ctz(hits);
+            newlines += __builtin_popcount(below(nls, index));
+            return i + index;
+        }
+        newlines += __builtin_popcount(nls);
+    }
+    return i + find_string_end_scalar(p + i, n - i, newlines);
+}
+
+inline __m128i in_range_sse2(__m128i v, char lo, char hi)
+{
+    return _mm_and_si128(_mm_cmpgt_epi8(v, _mm_set1_epi8(lo - 1)), _mm_cmplt_epi8(v, _mm_set1_epi8(hi + 1)));
+}
+
+size_t identifier_length_sse2(const char *p, size_t n)
+{
+    const __m128i case_bit = _mm_set1_epi8(0x20);
+    const __m128i dot      = _mm_set1_epi8('.');
+    const __m128i under    = _mm_set1_epi8('_');
+    size_t        i        = 0;
+    for(; i + 16 <= n; i += 16)
+    {
+        __m128i v     = _mm_loadu_si128(reinterpret_cast<const __m128i *>(p + i));
+        __m128i alpha = in_range_sse2(_mm_or_si128(v, case_bit), 'a', 'z');
+        __m128i digit = in_range_sse2(v, '0', '9');
+        __m128i punct = _mm_or_si128(_mm_cmpeq_epi8(v, dot), _mm_cmpeq_epi8(v, under));
+        unsigned other =
+            ~_mm_movemask_epi8(_mm_or_si128(_mm_or_si128(alpha, digit), punct)) & 0xFFFF;
+        if(other)
+        {
+            return i + __builtin_ctz(other);
+        }
+    }
+    return i + identifier_length_scalar(p + i, n - i);
+}
+
+__attribute__((target("avx2"))) size_t skip_whitespace_avx2(const char *p, size_t n, int &newlines)
+{
+    const __m256i space = _mm256_set1_epi8(' ');
+    const __m256i tab   = _mm256_set1_epi8('\t');
+    const __m256i nl    = _mm256_set1_epi8('\n');
+    size_t        i     = 0;
+    for(; i + 32 <= n; i += 32)
+    {
+        __m256i  v    = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(p + i));
+        __m256i  isnl = _mm256_cmpeq_epi8(v, nl);
+        __m256i  ws   = _mm256_or_si256(_mm256_or_si256(_mm256_cmpeq_epi8(v, space), _mm256_cmpeq_epi8(v, tab)), isnl);
+        unsigned nls  = _mm256_movemask_epi8(isnl);
+        unsigned other = ~static_cast<unsigned>(_mm256_movemask_epi8(ws));
+        if(other)
+        {
+            unsigned index = __builtin_ctz(other);
+            newlines += __builtin_popcount(below(nls, index));
+            return i + index;
+        }
+        newlines += __builtin_popcount(nls);
+    }
+    return i + skip_whitespace_sse2(p + i, n - i, newlines);
+}
+
+__attribute__((target("avx2"))) size_t find_line_end_avx2(const char *p, size_t n)
+{
+    const __m256i nl   = _mm256_set1_epi8('\n');
+    const __m256i zero = _mm256_setzero_si256();
+    size_t        i    = 0;
+    for(; i + 32 <= n; i += 32)
+    {
+        __m256i  v    = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(p + i));
+        unsigned hits = _mm256_movemask_epi8(_mm256_or_si256(_mm256_cmpeq_epi8(v, nl), _mm256_cmpeq_epi8(v, zero)));
+        if(hits)
+        {
+            return i + __builtin_ctz(hits);
+        }
+    }
+    return i + find_line_end_sse2(p + i, n - i);
+}
+
+__attribute__((target("avx2"))) size_t find_string_end_avx2(const char *p, size_t n, int &newlines)
+{
+    const __m256i quote = _mm256_set1_epi8('"');
+    const __m256i nl    = _mm256_set1_epi8('\n');
+    const __m256i zero  = _mm256_setzero_si256();
+    size_t        i     = 0;
+    for(; i + 32 <= n; i += 32)
+    {
+        __m256i  v    = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(p + i));
+        unsigned nls  = _mm256_movemask_epi8(_mm256_cmpeq_epi8(v, nl));
+        unsigned hits = _mm256_movemask_epi8(_mm256_or_si256(_mm256_cmpeq_epi8(v, quote), _mm256_cmpeq_epi8(v, zero)));
+        if(hits)
+        {
+            unsigned index = __builtin_ctz(hits);
+            newlines += __builtin_popcount(below(nls, index));
+            return i + index;
+        }
+        newlines += __builtin_popcount(nls);
+    }
+    return i + find_string_end_sse2(p + i, n - i, newlines);
+}
+
+__attribute__((target("avx2"))) inline __m256i in_range_avx2(__m256i v, char lo, char hi)
+{
+    return _mm256_and_si256(_mm256_cmpgt_epi8(v, _mm256_set1_epi8(lo - 1)),
+                            _mm256_cmpgt_epi8(_mm256_set1_epi8(hi + 1), v));
+}
+
+__attribute__((target("avx2"))) size_t identifier_length_avx2(const char *p, size_t n)
+{
+    const __m256i case_bit = _mm256_set1_epi8(0x20);
+    const __m256i dot      = _mm256_set1_epi8('.');
+    const __m256i under    = _mm256_set1_epi8('_');
+    size_t        i        = 0;
+    for(; i + 32 <= n; i += 32)
+    {
+        __m256i  v     = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(p + i));
+        __m256i  alpha = in_range_avx2(_mm256_or_si256(v, case_bit), 'a', 'z');
+        __m256i  digit = in_range_avx2(v, '0', '9');
+        __m256i  punct = _mm256_or_si256(_mm256_cmpeq_epi8(v, dot), _mm256_cmpeq_epi8(v, under));
+        unsigned other =
+            ~static_cast<unsigned>(_mm256_movemask_epi8(_mm256_or_si256(_mm256_or_si256(alpha, digit), punct)));
+        if(other)
+        {
+            return i + __builtin_ctz(other);
+        }
+    }
+    return i + identifier_length_sse2(p + i, n - i);
+}
+#endif
+
+const ScanKernels scalar_kernels = {"scalar",
+                                    skip_whitespace_scalar,
+                                    find_line_end_scalar,
+                                    find_string_end_scalar,
+                                    identifier_length_scalar};
+#ifdef LOX_X86_KERNELS
+const ScanKernels sse2_kernels = {"sse2",
+                                  skip_whitespace_sse2,
+                                  find_line_end_sse2,
+                                  find_string_end_sse2,
+                                  identifier_length_sse2};
+const ScanKernels avx2_kernels = {"avx2",
+                                  skip_whitespace_avx2,
+                                  find_line_end_avx2,
+                                  find_string_end_avx2,
+                                  identifier_length_avx2};
+#endif
+
+const ScanKernels &select_kernels()
+{
+    const char      *forced = std::getenv("LOX_SCAN_KERNEL");
+    std::string_view choice = forced ? forced : "";
+    if(choice == "scalar")
+    {
+        return scalar_kernels;
+    }
+#ifdef LOX_X86_KERNELS
+    __builtin_cpu_init();
+    if(choice != "sse2" && __builtin_cpu_supports("avx2"))
+    {
+        return avx2_kernels;
+    }
+    return sse2_kernels;
+#else
+    return scalar_kernels;
+#endif
+}
+} // namespace
+
+const ScanKernels &scan_kernels()
+{
+    static const ScanKernels &kernels = select_kernels();
+    return kernels;
+}
+} // namespace lox
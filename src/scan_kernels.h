@@ -0,0 +1,28 @@
+#ifndef SCAN_KERNELS_H
+#define SCAN_KERNELS_H
+
+#include <cstddef>
+#include <string_view>
+
+namespace lox {
+// block-at-a-time helpers for the scanner's hot loops. every function takes
+// the remaining input [p, p + n) and returns how many bytes it consumed
+struct ScanKernels
+{
+    std::string_view name;
+    // length of the leading run of ' ', '\t' and '\n', adding the newlines seen
+    size_t (*skip_whitespace)(const char *p, size_t n, int &newlines);
+    // offset of the first '\n' or '\0' (end of a // comment), or n
+    size_t (*find_line_end)(const char *p, size_t n);
+    // offset of the first '"' or '\0', adding the newlines before it
+    size_t (*find_string_end)(const char *p, size_t n, int &newlines);
+    // length of the leading run of [A-Za-z0-9._]
+    size_t (*identifier_length)(const char *p, size_t n);
+};
+
+// the widest implementation the CPU supports, chosen once on first use;
+// LOX_SCAN_KERNEL=scalar|sse2|avx2 forces a specific one
+const ScanKernels &scan_kernels();
+} // namespace lox
+
+#endif // SCAN_KERNELS_H
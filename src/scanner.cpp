@@ -1,15 +1,52 @@
 #include "scanner.h"
+#include <charconv>
 
 namespace lox {
 
-void Scanner::read_file()
+std::vector<Token> Scanner::get_tokens()
 {
-    try {
-        while (true) {
+    std::vector<Token> tokens;
+    do {
+        tokens.push_back(next_token());
+    } while (tokens.back().type != TokenType::END_OF_FILE);
+    return tokens;
+}
+
+Token Scanner::next_token()
+{
+    fill();
+    return pending[pending_head++];
+}
+
+void Scanner::finish()
+{
+    while (next_token().type != TokenType::END_OF_FILE) {
+    }
+}
+
+void Scanner::fill()
+{
+    if (pending_head < pending.size()) {
+        return;
+    }
+    scan_pending();
+    if (stats && pending.front().type != TokenType::END_OF_FILE) {
+        stats->tokens += pending.size();
+    }
+}
+
+// scans until at least one token is buffered; a lexeme can yield more than
+// one token (e.g. "12abc"), so the buffer holds whatever the last step made
+void Scanner::scan_pending()
+{
+    while (pending_head == pending.size()) {
+        pending.clear();
+        pending_head = 0;
+        if (current >= p_file_contents.size()) {
+            pending.push_back(Token(TokenType::END_OF_FILE, "", line_number));
+        } else {
             scanChar();
         }
-    } catch (const std::runtime_error &e) {
-        //std::cerr << e.what() << std::endl;
     }
 }
 
@@ -28,7 +65,7 @@ void Scanner::scanChar()
     case '+':
     case ';':
     case '*':
-        add_token(std::string(1, c));
+        add_symbol(single_char_token(c), current - 1);
         break;
     case '#':
     case '@':
@@ -50,162 +87,168 @@ void Scanner::scanChar()
         handle_string();
         break;
     case '\n':
-        line_number++;
-        break;
     case '\t':
     case ' ':
+        current--;
+        current += kernels.skip_whitespace(remaining(), p_file_contents.size() - current, line_number);
         break;
     default:
-        handle_default(c);
+        handle_default();
         break;
     }
 }
 
-void Scanner::add_token(std::string s)
+void Scanner::add_token(std::string_view s)
 {
-    if (add_existing_token(s) || add_reserved_keyword(s) || add_string_token(s) || add_number_token(s)) {
+    TokenType keyword = keyword_type(s);
+    if (keyword != TokenType::IDENTIFIER) {
+        pending.push_back(Token(keyword, s, line_number));
         return;
     }
+    add_number_token(s);
     if (!s.empty()) {
-        tokens.push_back(Token(TokenType::IDENTIFIER, s, s, line_number));
+        pending.push_back(Token(TokenType::IDENTIFIER, s, line_number));
     }
 }
 
-bool Scanner::add_existing_token(const std::string& s) {
-    auto it = std::find_if(tokenident.begin(), tokenident.end(), [&s](const auto &p) { return p.second.second == s; });
-    if(it != tokenident.end()) {
-        tokens.push_back(Token(it->first, "", "", line_number));
-        return true;
-    }
-    return false;
+void Scanner::add_symbol(TokenType type, size_t start)
+{
+    pending.push_back(Token(type, lexeme_from(start), line_number));
 }
 
-bool Scanner::add_reserved_keyword(const std::string& s) {
-    if(reservedkeywords.find(s) != reservedkeywords.end()) {
-        auto t = s;
-        auto u = s;
-        std::transform(t.begin(), t.end(), t.begin(), ::tolower);
-        std::transform(u.begin(), u.end(), u.begin(), ::toupper);
-        tokens.push_back(Token(reservedkeywords.at(t), u, t, line_number));
-        return true;
+bool Scanner::add_number_token(std::string_view& s) {
+    size_t length = 0;
+    int countdots = 0;
+    while(length < s.size() && (isdigit(s[length]) || (countdots == 0 && s[length] == '.'))) {
+        if(s[length] == '.') {
+            countdots++;
+        }
+        length++;
     }
-    return false;
-}
-
-bool Scanner::add_string_token(const std::string& s) {
-    if(s.size() > 1 && s[0] == '\"' && s[s.size() - 1] == '\"') {
-        std::string lexeme  = s;
-        std::string literal = s.substr(1, s.size() - 2);
-        tokens.push_back(Token(TokenType::STRING, lexeme, literal, line_number));
-        return true;
+    if(length != 0) {
+        std::string_view t = s.substr(0, length);
+        double value = 0.0;
+        std::from_chars(t.data(), t.data() + t.size(), value);
+        pending.push_back(Token(TokenType::NUMBER, t, line_number, value));
+        s.remove_prefix(length);
     }
     return false;
 }
 
-bool Scanner::add_number_token(std::string& s) {
-    std::string t;
-    int countdots = 0;
-    while(!s.empty() && (isdigit(s[0]) || (countdots == 0 && s[0] == '.'))) {
-        if(s[0] == '.') {
-            countdots++;
-        }
-        t += s[0];
-        s.erase(s.begin());
-    }
-    if(!t.empty()) {
-        std::string num = t + ".0";
-        if(countdots == 1) {
-            num = t;
-            auto it = std::find_if(num.rbegin(), num.rend(), [](char &c) { return c != '0'; });
-            num.erase(it.base(), num.end());
-            if(num[num.size() - 1] == '.') {
-                num += "0";
-            }
-        }
-        tokens.push_back(Token(TokenType::NUMBER, t, num, line_number));
+void Scanner::error(std::string message) {
+    if (collected) {
+        collected->push_back({line_number, std::move(message)});
+    } else {
+        diagnostics.error(line_number, "", message);
     }
-    return false;
 }
 
 void Scanner::handle_unexpected_char(char c) {
-    std::cerr << "[line " << line_number << "] Error: Unexpected character: " << c << std::endl;
-    error.set_retvalue(65);
+    std::string message = "Unexpected character: ";
+    message += c;
+    error(std::move(message));
 }
 
 void Scanner::handle_two_char_token(char c) {
-    std::string curr(1, c);
+    size_t start = current - 1;
     if(peek() == '=') {
-        curr += advance();
+        advance();
+        add_symbol(two_char_token(c), start);
+    } else {
+        add_symbol(single_char_token(c), start);
     }
-    add_token(curr);
 }
 
 void Scanner::handle_slash() {
     if(peek() == '/') {
-        while(peek() != '\n' && peek() != '\0') {
-            advance();
-        }
+        current += kernels.find_line_end(remaining(), p_file_contents.size() - current);
     } else {
-        add_token(std::string(1, '/'));
+        add_symbol(TokenType::SLASH, current - 1);
     }
 }
 
 void Scanner::handle_string() {
-    std::string ans;
-    while(peek() != '\"' && peek() != '\0') {
-        if(peek() == '\n') line_number++;
-        ans += advance();
-    }
+    size_t start = current - 1;
+    current += kernels.find_string_end(remaining(), p_file_contents.size() - current, line_number);
     if(peek() == '\0') {
-        std::cerr << "[line " << line_number << "] Error: Unterminated string." << std::endl;
-        error.set_retvalue(65);
+        open_string = true;
+        error("Unterminated string.");
     } else {
         advance();
-        add_token("\"" + ans + "\"");
+        pending.push_back(Token(TokenType::STRING, lexeme_from(start), line_number));
     }
 }
 
-void Scanner::handle_default(char c) {
-    std::string ans(1, c);
-    while (!isspace(peek()) && peek() != '\0' && (isalnum(peek()) || peek() == '.' || peek() == '_')) {
-        ans += advance();
-    }
-    add_token(ans);
+void Scanner::handle_default() {
+    size_t start = current - 1;
+    current += kernels.identifier_length(remaining(), p_file_contents.size() - current);
+    add_token(lexeme_from(start));
 }
 
 char Scanner::peek()
 {
-    return p_file_contents[current];
+    return current < p_file_contents.size() ? p_file_contents[current] : '\0';
 }
 
 char Scanner::advance()
 {
     if(current >= p_file_contents.size())
     {
-        add_token("");
-        throw std::runtime_error("Reached EOF");
         return '\0';
     }
     return p_file_contents[current++];
 }
 
+const char *Scanner::remaining() const
+{
+    return p_file_contents.data() + current;
+}
+
+std::string_view Scanner::lexeme_from(size_t start) const
+{
+    return p_file_contents.substr(start, current - start);
+}
+
+std::string Token::literal() const
+{
+    if(type == TokenType::STRING)
+    {
+        return std::string(lexeme.substr(1, lexeme.size() - 2));
+    }
+    if(type != TokenType::NUMBER)
+    {
+        return std::string(lexeme);
+    }
+    std::string num(lexeme);
+    if(num.find('.') == std::string::npos)
+    {
+        return num + ".0";
+    }
+    num.erase(num.find_last_not_of('0') + 1);
+    if(num.back() == '.')
+    {
+        num += "0";
+    }
+    return num;
+}
+
 std::ostream &operator<<(std::ostream &os, const Token &token)
 {
-    if(tokenident.find(token.type) != tokenident.end())
+    if(is_symbol_token(token.type))
     {
-        os << tokenident.at(token.type).first << " " << tokenident.at(token.type).second << " null";
+        os << token_name(token.type) << " " << token_symbol(token.type) << " null";
     }
     else if(token.type == TokenType::STRING)
     {
-        os << "STRING " << token.lexeme << " " << token.literal;
+        os << "STRING " << token.lexeme << " " << token.literal();
     }
     else if(token.type == TokenType::NUMBER)
     {
-        os << "NUMBER " << token.lexeme << " " << token.literal;
+        os << "NUMBER " << token.lexeme << " " << token.literal();
     }
     else if(token.type >= TokenType::AND && token.type <= TokenType::WHILE)
     {
-        os << token.lexeme << " " << token.literal << " null";
+        os << token_name(token.type) << " " << token.lexeme << " null";
     }
     else
     {
@@ -213,32 +256,4 @@ std::ostream &operator<<(std::ostream &os, const Token &token)
     }
     return os;
 }
-
-void ErrorInScanner::add_error(std::string s)
-{
-    msg.push_back(std::move(s));
-}
-
-ErrorInScanner::~ErrorInScanner()
-{
-    for(const auto &error: msg)
-    {
-        std::cerr << error << std::endl;
-    }
-    if(retvalue !=0)
-    {
-        exit(retvalue);
-    }
-}
-
-int ErrorInScanner::get_retvalue() const
-{
-    return retvalue;
-}
-
-void ErrorInScanner::set_retvalue(int value)
-{
-    retvalue = value;
-}
-
 } // namespace lox
\ No newline at end of file
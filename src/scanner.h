@@ -2,71 +2,104 @@
 #define SCANNER_H
 
 #include "consts.h"
+#include "diagnostics.h"
+#include "scan_kernels.h"
+#include "stats.h"
 #include <iostream>
 #include <sstream>
+#include <string>
+#include <string_view>
 #include <vector>
 #include <algorithm>
 
 namespace lox{
 
-class ErrorInScanner
-{
-  public:
-    ErrorInScanner() = default;
-    void add_error(std::string s);
-    ~ErrorInScanner();
-
-    int  get_retvalue() const;
-    void set_retvalue(int value);
-
-  private:
-    std::vector<std::string> msg;
-    int                      retvalue = 0;
-};
-
+// trivially copyable token: the lexeme is a view into the scanned source,
+// numbers carry their decoded value and the printable literal is derived
+// on demand by literal()
 class Token{
     public:
-        Token(TokenType type, std::string lexeme, std::string literal, int line) : type(type), lexeme(lexeme), literal(literal), line(line) {}
+        Token(TokenType type, std::string_view lexeme, int line, double number = 0.0)
+            : type(type), line(line), lexeme(lexeme), number(number)
+        {
+        }
+        std::string          literal() const;
         friend std::ostream &operator<<(std::ostream &os, const Token &token);
-        int                  line;
-        std::string          lexeme;
-        std::string          literal;
         TokenType            type;
+        int                  line;
+        std::string_view     lexeme;
+        double               number;
 
       private:
 };
 
+// a lexical error held back instead of reported, see Scanner::collect_errors
+struct ScanError
+{
+    int         line;
+    std::string message;
+};
+
+// produces tokens on demand: next_token() scans only as far as needed for
+// the next token and keeps returning END_OF_FILE once the input is exhausted
 class Scanner {
   public:
-    Scanner(const std::string &file_contents) : p_file_contents(file_contents) {}
-    std::vector<Token> get_tokens()
+    // lexical errors are reported to `diagnostics` and scanning carries on.
+    // `line` is the line number of the first byte, for scanning a slice
+    Scanner(std::string_view file_contents, Diagnostics &diagnostics, int line = 1)
+        : p_file_contents(file_contents), line_number(line), diagnostics(diagnostics)
+    {
+    }
+    std::vector<Token> get_tokens();
+    Token              next_token();
+    // scans the rest of the input so every lexical error gets reported
+    void               finish();
+    // appends lexical errors to `errors` instead of reporting them
+    void               collect_errors(std::vector<ScanError> *errors)
+    {
+        collected = errors;
+    }
+    // whether the input ended inside a string literal, once scanning got there
+    bool               ended_in_string() const
+    {
+        return open_string;
+    }
+    // counts the tokens scanned into `stats`; null turns it off. the scanner
+    // does not time itself: a timer per token would cost more than the scan
+    void               set_stats(Stats *stats)
     {
-        read_file();
-        return tokens;
+        this->stats = stats;
     }
 
   private:
-    void read_file();
+    void fill();
+    void scan_pending();
     void scanChar();
-    void add_token(std::string s);
-    bool add_existing_token(const std::string &s);
-    bool add_reserved_keyword(const std::string &s);
-    bool add_string_token(const std::string &s);
-    bool add_number_token(std::string &s);
+    void add_token(std::string_view s);
+    void add_symbol(TokenType type, size_t start);
+    bool add_number_token(std::string_view &s);
+    void error(std::string message);
     void handle_unexpected_char(char c);
     void handle_two_char_token(char c);
     void handle_slash();
     void handle_string();
-    void handle_default(char c);
+    void handle_default();
     char peek();
     char advance();
+    const char *remaining() const;
+    std::string_view lexeme_from(size_t start) const;
 
-    std::vector<Token> tokens;
-    std::string p_file_contents;
-    int current = 0;
+    std::vector<Token> pending;
+    size_t pending_head = 0;
+    std::string_view p_file_contents;
+    size_t current = 0;
     int _start = -1;
     int line_number = 1;
-    ErrorInScanner error;
+    bool open_string = false;
+    const ScanKernels &kernels = scan_kernels();
+    Diagnostics &diagnostics;
+    Stats *stats = nullptr;
+    std::vector<ScanError> *collected = nullptr;
 };
 } // namespace lox
 
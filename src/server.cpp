@@ -0,0 +1,373 @@
+#include "server.h"
+#include <algorithm>
+#include <cerrno>
+#include <cstdint>
+#include <cstring>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <streambuf>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/time.h>
+#include <sys/un.h>
+#include <thread>
+#include <unistd.h>
+#include <unordered_map>
+#include <vector>
+
+namespace lox {
+namespace {
+// compiled programs the daemon keeps for sources it has seen, shared by all
+// workers and bounded by count and by the bytes the sessions hold
+constexpr size_t CACHED_PROGRAMS = 64;
+constexpr size_t CACHED_BYTES    = size_t(64) << 20;
+constexpr size_t FRAME_CAPACITY  = 64 * 1024;
+constexpr size_t HEADER_SIZE     = 5;
+// a connection that sends or takes nothing for this long is dropped, so an
+// idle or vanished client cannot hold a worker
+constexpr time_t IDLE_TIMEOUT_SECONDS = 30;
+
+void put_u32(char *p, uint32_t value)
+{
+    for(int i = 0; i < 4; i++)
+    {
+        p[i] = static_cast<char>(value >> (8 * i));
+    }
+}
+
+uint32_t get_u32(const char *p)
+{
+    uint32_t value = 0;
+    for(int i = 0; i < 4; i++)
+    {
+        value |= static_cast<uint32_t>(static_cast<unsigned char>(p[i])) << (8 * i);
+    }
+    return value;
+}
+
+// send() rather than write() so a vanished peer is an error, not SIGPIPE
+bool write_all(int fd, const char *data, size_t size)
+{
+    while(size > 0)
+    {
+        ssize_t n = ::send(fd, data, size, MSG_NOSIGNAL);
+        if(n < 0)
+        {
+            if(errno == EINTR) continue;
+            return false;
+        }
+        data += n;
+        size -= n;
+    }
+    return true;
+}
+
+// false on error or if the peer closes before `size` bytes arrived
+bool read_all(int fd, char *data, size_t size)
+{
+    while(size > 0)
+    {
+        ssize_t n = ::recv(fd, data, size, 0);
+        if(n < 0 && errno == EINTR) continue;
+        if(n <= 0) return false;
+        data += n;
+        size -= n;
+    }
+    return true;
+}
+
+bool write_frame(int fd, char kind, const char *data, size_t size)
+{
+    char header[HEADER_SIZE];
+    header[0] = kind;
+    put_u32(header + 1, static_cast<uint32_t>(size));
+    return write_all(fd, header, HEADER_SIZE) && write_all(fd, data, size);
+}
+
+// stream buffer sending what is written to it as frames of one kind, one
+// per flush or per full buffer. once the client is gone output is dropped,
+// so the script still runs to completion
+class FrameBuffer : public std::streambuf
+{
+  public:
+    FrameBuffer(int fd, char kind) : fd(fd), kind(kind), buffer(FRAME_CAPACITY)
+    {
+        setp(buffer.data(), buffer.data() + buffer.size());
+    }
+
+  protected:
+    int_type overflow(int_type c) override
+    {
+        sync();
+        if(!traits_type::eq_int_type(c, traits_type::eof()))
+        {
+            *pptr() = traits_type::to_char_type(c);
+            pbump(1);
+        }
+        return traits_type::not_eof(c);
+    }
+
+    int sync() override
+    {
+        size_t size = pptr() - pbase();
+        setp(buffer.data(), buffer.data() + buffer.size());
+        if(size > 0 && !failed)
+        {
+            failed = !write_frame(fd, kind, buffer.data(), size);
+        }
+        return 0;
+    }
+
+  private:
+    int               fd;
+    char              kind;
+    std::vector<char> buffer;
+    bool              failed = false;
+};
+
+// sessions of recently compiled sources, least recently used first out. a
+// session is taken out while it runs, since only one thread may use it; two
+// workers running the same source at once each compile their own copy
+class SessionCache
+{
+  public:
+    // the session that compiled `source`, now the caller's; null if none
+    std::unique_ptr<Session> take(const std::string &source)
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        auto                        cached = index.find(source);
+        if(cached == index.end()) return nullptr;
+        std::unique_ptr<Session> session = std::move(cached->second->session);
+        cached_bytes -= cached->second->bytes;
+        programs.erase(cached->second);
+        index.erase(cached);
+        return session;
+    }
+
+    // gives the session that compiled `source` to the cache
+    void remember(std::string source, std::unique_ptr<Session> session)
+    {
+        size_t bytes = source.size() + session->memory_size();
+        if(bytes > CACHED_BYTES) return;
+        // evicted sessions are destroyed after the lock is released
+        std::vector<std::unique_ptr<Session>> evicted;
+        std::lock_guard<std::mutex>           lock(mutex);
+        if(index.count(source)) return;
+        while(!programs.empty() && (programs.size() >= CACHED_PROGRAMS || cached_bytes + bytes > CACHED_BYTES))
+        {
+            cached_bytes -= programs.back().bytes;
+            index.erase(programs.back().source);
+            evicted.push_back(std::move(programs.back().session));
+            programs.pop_back();
+        }
+        cached_bytes += bytes;
+        programs.push_front({std::move(source), std::move(session), bytes});
+        // the key views the source in the list node, which never moves
+        index.emplace(programs.front().source, programs.begin());
+    }
+
+  private:
+    struct Program
+    {
+        std::string              source;
+        std::unique_ptr<Session> session;
+        size_t                   bytes;
+    };
+
+    std::mutex                                                         mutex;
+    std::list<Program>                                                 programs; // most recently used first
+    std::unordered_map<std::string_view, std::list<Program>::iterator> index;
+    size_t                                                             cached_bytes = 0;
+};
+
+// the per-thread side of the daemon: serves one connection at a time
+class Worker
+{
+  public:
+    Worker(Engine engine, SessionCache &cache) : engine(engine), cache(cache) {}
+
+    void serve_connection(int fd)
+    {
+        char header[4];
+        while(read_all(fd, header, sizeof header))
+        {
+            uint32_t size = get_u32(header);
+            if(size > protocol::MAX_SOURCE_SIZE) return;
+            std::string source(size, '\0');
+            if(!read_all(fd, source.data(), size)) return;
+
+            FrameBuffer  out_frames(fd, protocol::OUTPUT);
+            FrameBuffer  err_frames(fd, protocol::ERRORS);
+            std::ostream out(&out_frames);
+            std::ostream err(&err_frames);
+            // error reports flush the output first so the two keep their order
+            err.tie(&out);
+            int status = run(std::move(source), out, err);
+            out.flush();
+            err.flush();
+
+            char payload[4];
+            put_u32(payload, static_cast<uint32_t>(status));
+            if(!write_frame(fd, protocol::EXIT, payload, sizeof payload)) return;
+        }
+    }
+
+  private:
+    int run(std::string source, std::ostream &out, std::ostream &err)
+    {
+        try
+        {
+            std::unique_ptr<Session> session = cache.take(source);
+            if(session)
+            {
+                session->set_output(out);
+                session->set_error_output(err);
+                session->reset();
+            }
+            else
+            {
+                session = std::make_unique<Session>(engine);
+                session->set_output(out);
+                session->set_error_output(err);
+                if(!session->load(source))
+                {
+                    return session->status();
+                }
+            }
+            session->run();
+            int status = session->status();
+            cache.remember(std::move(source), std::move(session));
+            return status;
+        }
+        catch(const std::exception &error)
+        {
+            err << "Internal error: " << error.what() << std::endl;
+            return 70;
+        }
+    }
+
+    Engine        engine;
+    SessionCache &cache;
+};
+} // namespace
+
+int serve(const std::string &socket_path, Engine engine, unsigned workers, std::ostream &log)
+{
+    sockaddr_un address{};
+    address.sun_family = AF_UNIX;
+    if(socket_path.size() >= sizeof address.sun_path)
+    {
+        log << "Socket path too long: " << socket_path << std::endl;
+        return 1;
+    }
+    std::memcpy(address.sun_path, socket_path.c_str(), socket_path.size() + 1);
+
+    // a socket left behind by an earlier daemon would make bind() fail, but
+    // one that a running daemon still answers on is not ours to take
+    struct stat info;
+    if(::lstat(socket_path.c_str(), &info) == 0 && S_ISSOCK(info.st_mode))
+    {
+        int  probe     = ::socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+        bool answered  = probe >= 0 && ::connect(probe, reinterpret_cast<sockaddr *>(&address), sizeof address) == 0;
+        int  connected = errno;
+        if(probe >= 0) ::close(probe);
+        if(answered)
+        {
+            log << "A daemon is already listening on " << socket_path << std::endl;
+            return 1;
+        }
+        if(connected == ECONNREFUSED)
+        {
+            ::unlink(socket_path.c_str());
+        }
+    }
+
+    int listener = ::socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if(listener < 0 || ::bind(listener, reinterpret_cast<sockaddr *>(&address), sizeof address) != 0 ||
+       ::listen(listener, SOMAXCONN) != 0)
+    {
+        log << "Cannot listen on " << socket_path << ": " << std::strerror(errno) << std::endl;
+        if(listener >= 0) ::close(listener);
+        return 1;
+    }
+    log << "Listening on " << socket_path << std::endl;
+
+    if(workers == 0)
+    {
+        workers = std::max(1u, std::thread::hardware_concurrency());
+    }
+    // every worker blocks in accept() on the shared socket and the kernel
+    // hands each connection to exactly one of them
+    SessionCache             cache;
+    std::vector<std::thread> threads;
+    for(unsigned i = 0; i < workers; i++)
+    {
+        threads.emplace_back([listener, engine, &cache] {
+            Worker worker(engine, cache);
+            for(;;)
+            {
+                int fd = ::accept4(listener, nullptr, nullptr, SOCK_CLOEXEC);
+                if(fd < 0)
+                {
+                    if(errno == EINTR || errno == ECONNABORTED) continue;
+                    return;
+                }
+                timeval timeout{IDLE_TIMEOUT_SECONDS, 0};
+                ::setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof timeout);
+                ::setsockopt(fd, SOL_SOCKET, SO_SNDTIMEO, &timeout, sizeof timeout);
+                worker.serve_connection(fd);
+                ::close(fd);
+            }
+        });
+    }
+    for(std::thread &thread: threads)
+    {
+        thread.join();
+    }
+    log << "Stopped accepting connections on " << socket_path << std::endl;
+    ::close(listener);
+    return 1;
+}
+
+int submit(const std::string &socket_path, std::string_view source, std::ostream &out, std::ostream &err)
+{
+    sockaddr_un address{};
+    address.sun_family = AF_UNIX;
+    if(socket_path.size() >= sizeof address.sun_path || source.size() > protocol::MAX_SOURCE_SIZE)
+    {
+        err << "Cannot submit to " << socket_path << ": path or script too long" << std::endl;
+        return 1;
+    }
+    std::memcpy(address.sun_path, socket_path.c_str(), socket_path.size() + 1);
+
+    int fd = ::socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if(fd < 0 || ::connect(fd, reinterpret_cast<sockaddr *>(&address), sizeof address) != 0)
+    {
+        err << "Cannot connect to " << socket_path << ": " << std::strerror(errno) << std::endl;
+        if(fd >= 0) ::close(fd);
+        return 1;
+    }
+
+    char length[4];
+    put_u32(length, static_cast<uint32_t>(source.size()));
+    char              header[HEADER_SIZE];
+    std::vector<char> payload;
+    bool              sent = write_all(fd, length, sizeof length) && write_all(fd, source.data(), source.size());
+    while(sent && read_all(fd, header, HEADER_SIZE))
+    {
+        payload.resize(get_u32(header + 1));
+        if(!read_all(fd, payload.data(), payload.size())) break;
+        if(header[0] == protocol::EXIT && payload.size() == 4)
+        {
+            ::close(fd);
+            return static_cast<int>(get_u32(payload.data()));
+        }
+        std::ostream &sink = header[0] == protocol::ERRORS ? err : out;
+        sink.write(payload.data(), payload.size());
+    }
+    err << "Connection to " << socket_path << " closed before the script finished" << std::endl;
+    ::close(fd);
+    return 1;
+}
+} // namespace lox
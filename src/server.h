@@ -0,0 +1,40 @@
+#ifndef SERVER_H
+#define SERVER_H
+
+#include "session.h"
+#include <iostream>
+#include <string>
+#include <string_view>
+
+namespace lox {
+// local daemon protocol over a Unix domain stream socket. all integers are
+// 32-bit little-endian.
+//
+//   request:  length, then `length` bytes of script source. a connection may
+//             carry any number of requests, one after the other
+//   response: frames of a kind byte, a length and `length` bytes:
+//             'o' program output, 'e' error reports, in the order they were
+//             produced, and finally 'x' with the 4-byte exit status
+namespace protocol {
+constexpr size_t MAX_SOURCE_SIZE = size_t(1) << 28;
+constexpr char   OUTPUT          = 'o';
+constexpr char   ERRORS          = 'e';
+constexpr char   EXIT            = 'x';
+} // namespace protocol
+
+// accepts connections on `socket_path` and runs each request with run
+// semantics on one of `workers` threads (0 for one per core), every request
+// against fresh globals. the workers share the programs compiled recently,
+// so a source seen before is not scanned or parsed again. a connection idle
+// for 30 seconds is closed. refuses to start while another daemon answers on
+// `socket_path`; a stale socket file is replaced. returns only when the
+// socket cannot be set up, after writing why to `log`
+int serve(const std::string &socket_path, Engine engine, unsigned workers, std::ostream &log);
+
+// sends `source` to the daemon at `socket_path`, copying the output frames to
+// `out` and the error frames to `err` as they arrive; returns the script's exit
+// status, or 1 after writing a connection error to `err`
+int submit(const std::string &socket_path, std::string_view source, std::ostream &out, std::ostream &err);
+} // namespace lox
+
+#endif // SERVER_H
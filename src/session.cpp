@@ -0,0 +1,375 @@
+#include "session.h"
+#include "compiler.h"
+#include "optimizer.h"
+#include "scanner.h"
+#include "vm.h"
+#include <algorithm>
+
+namespace lox {
+Session::Session(Engine engine) : engine(engine)
+{
+    diagnostics.emplace(captured);
+}
+
+void Session::set_output(std::ostream &out)
+{
+    this->out = &out;
+}
+
+void Session::set_error_output(std::ostream &sink)
+{
+    diagnostics.emplace(sink);
+    error_sink = &sink;
+}
+
+void Session::set_stats(Stats *stats)
+{
+    this->stats = stats;
+}
+
+void Session::set_cache(const ProgramCache *cache)
+{
+    this->cache = cache;
+}
+
+bool Session::load(std::string_view source)
+{
+    text         = source;
+    this->source = text;
+    return finish_load(compile());
+}
+
+bool Session::load(SourceBuffer source)
+{
+    file         = std::move(source);
+    this->source = file.view();
+    return finish_load(compile());
+}
+
+bool Session::load_file(const std::string &path)
+{
+    begin_call();
+    loaded = false;
+    bool read;
+    {
+        PhaseTimer timer(stats, Phase::READ);
+        read = file.load(path);
+    }
+    if(!read)
+    {
+        *error_sink << "Error reading file: " << path << '\n';
+        end_call();
+        exit_status = 1;
+        return finish_load(false);
+    }
+    source = file.view();
+    return finish_load(compile());
+}
+
+bool Session::run()
+{
+    begin_call();
+    if(!loaded)
+    {
+        end_call();
+        exit_status = load_status;
+        return false;
+    }
+    run_program(program, chunk);
+    return end_call();
+}
+
+bool Session::evaluate(std::string_view expression)
+{
+    begin_call();
+    scratch.reset();
+    scratch_text = expression;
+
+    Expression *expr;
+    {
+        PhaseTimer timer(stats, Phase::PARSE);
+        Scanner    scanner(scratch_text, *diagnostics);
+        scanner.set_stats(stats);
+        Parser parser(scanner, scratch, heap, *diagnostics);
+        expr = parser.parse();
+        // scan the rest so lexical errors anywhere are reported
+        scanner.finish();
+        if(stats)
+        {
+            stats->nodes = scratch.objects_allocated();
+        }
+        if(diagnostics->had_error())
+        {
+            return end_call();
+        }
+    }
+
+    Chunk expression_chunk;
+    {
+        PhaseTimer timer(stats, Phase::COMPILE);
+        expr = Optimizer(scratch, heap).optimize(expr);
+        if(engine == Engine::VM)
+        {
+            Compiler compiler(expression_chunk, *diagnostics, resolver);
+            if(!compiler.compile_expression(expr, false))
+            {
+                return end_call();
+            }
+        }
+        else
+        {
+            resolver.resolve(expr);
+        }
+    }
+
+    PhaseTimer timer(stats, Phase::EXECUTE);
+    if(engine == Engine::VM)
+    {
+        VM vm(heap, *diagnostics, globals, *out);
+        if(vm.run(expression_chunk) == INTERPRET_OK)
+        {
+            last_result = to_string(vm.result());
+        }
+        return end_call();
+    }
+    try
+    {
+        globals.reserve(resolver.slot_count());
+        last_result = to_string(expr->evaluate(heap, globals));
+    }
+    catch(const RuntimeError &error)
+    {
+        diagnostics->runtime_error(error.line, error.what());
+    }
+    return end_call();
+}
+
+bool Session::execute(std::string_view input, int line)
+{
+    begin_call();
+    scratch.reset();
+    scratch_text = input;
+
+    std::vector<Statement *> statements;
+    {
+        PhaseTimer timer(stats, Phase::PARSE);
+        Scanner    scanner(scratch_text, *diagnostics, line);
+        scanner.set_stats(stats);
+        Parser parser(scanner, scratch, heap, *diagnostics);
+        parser.parse_program(statements);
+        scanner.finish();
+        if(stats)
+        {
+            stats->nodes = scratch.objects_allocated();
+        }
+        if(diagnostics->had_error())
+        {
+            return end_call();
+        }
+    }
+
+    Chunk input_chunk;
+    {
+        PhaseTimer timer(stats, Phase::COMPILE);
+        Optimizer  optimizer(scratch, heap);
+        for(Statement *statement: statements)
+        {
+            optimizer.optimize(statement);
+        }
+        if(engine == Engine::VM)
+        {
+            Compiler compiler(input_chunk, *diagnostics, resolver);
+            if(!compiler.compile_program(statements))
+            {
+                return end_call();
+            }
+        }
+        else
+        {
+            for(Statement *statement: statements)
+            {
+                resolver.resolve(statement);
+            }
+        }
+    }
+    run_program(statements, input_chunk);
+    return end_call();
+}
+
+void Session::reset()
+{
+    globals = Globals();
+}
+
+int Session::status() const
+{
+    return exit_status;
+}
+
+const std::string &Session::result() const
+{
+    return last_result;
+}
+
+const std::string &Session::error() const
+{
+    return last_error;
+}
+
+size_t Session::memory_size() const
+{
+    return source.size() + arena.bytes_reserved() + program.capacity() * sizeof(Statement *) +
+           chunk.code.capacity() + chunk.constants.capacity() * sizeof(Value) +
+           chunk.globals.capacity() * sizeof(const ObjString *) + chunk.statement_ends.capacity() * sizeof(size_t) +
+           chunk.lines.capacity() * sizeof(Chunk::LineStart);
+}
+
+void Session::begin_call()
+{
+    diagnostics->reset();
+    captured.str("");
+    last_result.clear();
+    last_error.clear();
+}
+
+bool Session::end_call()
+{
+    exit_status = diagnostics->exit_code();
+    if(error_sink == &captured)
+    {
+        last_error = captured.str();
+    }
+    return exit_status == 0;
+}
+
+// remembers how the load went for run()
+bool Session::finish_load(bool ok)
+{
+    load_status = exit_status;
+    return ok;
+}
+
+// parses, optimizes and resolves or compiles `source` as the loaded program
+bool Session::compile()
+{
+    begin_call();
+    loaded = false;
+    arena.reset();
+    program.clear();
+    chunk = Chunk();
+    if(load_cached())
+    {
+        loaded = true;
+        return end_call();
+    }
+    {
+        PhaseTimer timer(stats, Phase::PARSE);
+        Scanner    scanner(source, *diagnostics);
+        scanner.set_stats(stats);
+        Parser parser(scanner, arena, heap, *diagnostics);
+        parser.parse_program(program);
+        scanner.finish();
+        if(stats)
+        {
+            stats->nodes = arena.objects_allocated();
+        }
+        if(diagnostics->had_error())
+        {
+            return end_call();
+        }
+    }
+
+    PhaseTimer timer(stats, Phase::COMPILE);
+    Optimizer  optimizer(arena, heap);
+    for(Statement *statement: program)
+    {
+        optimizer.optimize(statement);
+    }
+    if(engine == Engine::VM)
+    {
+        Compiler compiler(chunk, *diagnostics, resolver);
+        if(!compiler.compile_program(program))
+        {
+            return end_call();
+        }
+        if(cache)
+        {
+            cache->store(source, chunk);
+        }
+    }
+    else
+    {
+        for(Statement *statement: program)
+        {
+            resolver.resolve(statement);
+        }
+    }
+    loaded = true;
+    return end_call();
+}
+
+// runs `statements`, or for the VM their bytecode in `code`, reporting a
+// runtime error to the diagnostics
+void Session::run_program(const std::vector<Statement *> &statements, const Chunk &code)
+{
+    PhaseTimer timer(stats, Phase::EXECUTE);
+    if(engine == Engine::VM)
+    {
+        VM              vm(heap, *diagnostics, globals, *out);
+        InterpretResult result = vm.run(code);
+        if(stats)
+        {
+            // statements ending at or before the failing instruction completed
+            const auto &ends  = code.statement_ends;
+            stats->statements = result == INTERPRET_OK
+                                    ? ends.size()
+                                    : std::upper_bound(ends.begin(), ends.end(), vm.error_offset()) - ends.begin();
+        }
+        return;
+    }
+
+    globals.reserve(resolver.slot_count());
+    size_t executed = 0;
+    try
+    {
+        for(; executed < statements.size(); executed++)
+        {
+            statements[executed]->execute(heap, globals, *out);
+        }
+    }
+    catch(const RuntimeError &error)
+    {
+        diagnostics->runtime_error(error.line, error.what());
+    }
+    if(stats)
+    {
+        stats->statements = executed;
+    }
+}
+
+// fills `chunk` from the cache. the cached program names its globals in slot
+// order, which holds only while this session's resolver hands out the same
+// slots for them; otherwise the source is compiled after all
+bool Session::load_cached()
+{
+    if(engine != Engine::VM || !cache)
+    {
+        return false;
+    }
+    PhaseTimer timer(stats, Phase::READ);
+    if(cache->load(source, chunk, heap))
+    {
+        size_t slot = 0;
+        while(slot < chunk.globals.size() && resolver.declare(chunk.globals[slot]) == static_cast<int>(slot))
+        {
+            slot++;
+        }
+        if(slot == chunk.globals.size())
+        {
+            return true;
+        }
+    }
+    chunk = Chunk();
+    return false;
+}
+} // namespace lox
@@ -0,0 +1,127 @@
+#ifndef SESSION_H
+#define SESSION_H
+
+#include "arena.h"
+#include "chunk.h"
+#include "diagnostics.h"
+#include "parser.h"
+#include "program_cache.h"
+#include "resolver.h"
+#include "source.h"
+#include "stats.h"
+#include "value.h"
+#include <iostream>
+#include <optional>
+#include <sstream>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace lox {
+enum class Engine
+{
+    TREE, // walk the AST
+    VM    // compile to bytecode and run that
+};
+
+// one embeddable interpreter: the loaded program, its interned strings and
+// the global variables, which persist across run() and evaluate() calls.
+// sessions share no mutable state, so any number of them can live on any
+// number of threads; a single session must only be used by one at a time.
+// no call exits the process or throws on a script error: every call returns
+// false instead, and status() and error() tell what went wrong
+class Session
+{
+  public:
+    explicit Session(Engine engine = Engine::TREE);
+    Session(const Session &)            = delete;
+    Session &operator=(const Session &) = delete;
+
+    // where `print` writes; std::cout unless set
+    void set_output(std::ostream &out);
+    // error reports are written to `sink` as they happen. unless one is set
+    // they are kept instead, and error() returns those of the last call
+    void set_error_output(std::ostream &sink);
+    // phase times and counters of later calls go to `stats`; null stops that
+    void set_stats(Stats *stats);
+    // the VM engine takes programs from `cache` instead of compiling them
+    // when it has them, and stores the ones it compiles; null stops that.
+    // the cache must outlive the session's loads
+    void set_cache(const ProgramCache *cache);
+
+    // scans, parses and compiles a program, replacing the one loaded before.
+    // a string_view is copied; a SourceBuffer or the file load_file() maps is
+    // kept while the program stays loaded. false after a read, lexical or
+    // syntax error
+    bool load(std::string_view source);
+    bool load(SourceBuffer source);
+    bool load_file(const std::string &path);
+    // runs the loaded program from the top; false after a runtime error.
+    // without a loaded program nothing runs and run() fails with the status
+    // of the load that failed, or 1 when nothing was ever loaded
+    bool run();
+    // evaluates a single expression against the session's globals without
+    // printing it; the value is available from result()
+    bool evaluate(std::string_view expression);
+    // scans, parses and runs `input` as statements against the session's
+    // globals, leaving the loaded program alone; what the input declares is
+    // there for later calls. `line` is the line number of its first byte.
+    // false after a lexical, syntax or runtime error
+    bool execute(std::string_view input, int line = 1);
+    // forgets every global variable but keeps the loaded program, so the
+    // next run() behaves as in a fresh session without compiling again
+    void reset();
+
+    // exit status of the last call, as the command line reports it: 0, 65
+    // after a static error, 70 after a runtime error and 1 when the file
+    // could not be read
+    int                status() const;
+    // the printed form of the value of the last successful evaluate()
+    const std::string &result() const;
+    // reports of the last call when no error sink is set
+    const std::string &error() const;
+    // about how many bytes the loaded program holds: its source, syntax tree
+    // and bytecode. interned strings and globals are not counted
+    size_t             memory_size() const;
+
+  private:
+    void begin_call();
+    bool end_call();
+    bool finish_load(bool ok);
+    bool compile();
+    bool load_cached();
+    void run_program(const std::vector<Statement *> &statements, const Chunk &code);
+
+    Engine                        engine;
+    std::ostream                 *out = &std::cout;
+    std::ostringstream            captured;
+    std::ostream                 *error_sink = &captured;
+    std::optional<Diagnostics>    diagnostics;
+    Stats                        *stats = nullptr;
+    const ProgramCache           *cache = nullptr;
+
+    // the loaded program: its source, syntax tree and, for the VM, bytecode
+    SourceBuffer                  file;
+    std::string                   text;
+    std::string_view              source;
+    Arena                         arena;
+    std::vector<Statement *>      program;
+    Chunk                         chunk;
+    bool                          loaded      = false;
+    int                           load_status = 1;
+
+    // state that outlives programs; ASTs of evaluate() and execute() go to
+    // `scratch`
+    Heap                          heap;
+    Resolver                      resolver;
+    Globals                       globals;
+    Arena                         scratch;
+    std::string                   scratch_text;
+
+    int                           exit_status = 0;
+    std::string                   last_result;
+    std::string                   last_error;
+};
+} // namespace lox
+
+#endif // SESSION_H
@@ -0,0 +1,102 @@
+#include "source.h"
+#include <cerrno>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <utility>
+
+namespace lox {
+SourceBuffer::SourceBuffer(SourceBuffer &&other) noexcept
+    : mapped(std::exchange(other.mapped, nullptr)),
+      mapped_size(std::exchange(other.mapped_size, 0)),
+      buffer(std::move(other.buffer))
+{
+}
+
+SourceBuffer &SourceBuffer::operator=(SourceBuffer &&other) noexcept
+{
+    if(this != &other)
+    {
+        release();
+        mapped      = std::exchange(other.mapped, nullptr);
+        mapped_size = std::exchange(other.mapped_size, 0);
+        buffer      = std::move(other.buffer);
+    }
+    return *this;
+}
+
+SourceBuffer::~SourceBuffer()
+{
+    release();
+}
+
+bool SourceBuffer::load(const std::string &filename)
+{
+    release();
+    int fd = open(filename.c_str(), O_RDONLY | O_CLOEXEC);
+    if(fd < 0)
+    {
+        return false;
+    }
+
+    struct stat st;
+    bool        ok = fstat(fd, &st) == 0;
+    if(ok && S_ISREG(st.st_mode) && st.st_size > 0)
+    {
+        void *addr = mmap(nullptr, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+        if(addr != MAP_FAILED)
+        {
+            madvise(addr, st.st_size, MADV_SEQUENTIAL);
+            mapped      = static_cast<const char *>(addr);
+            mapped_size = st.st_size;
+            close(fd);
+            return true;
+        }
+    }
+    ok = ok && read_all(fd);
+    close(fd);
+    return ok;
+}
+
+std::string_view SourceBuffer::view() const
+{
+    if(mapped)
+    {
+        return std::string_view(mapped, mapped_size);
+    }
+    return buffer;
+}
+
+void SourceBuffer::release()
+{
+    if(mapped)
+    {
+        munmap(const_cast<char *>(mapped), mapped_size);
+        mapped      = nullptr;
+        mapped_size = 0;
+    }
+    buffer.clear();
+}
+
+bool SourceBuffer::read_all(int fd)
+{
+    constexpr size_t CHUNK = 1 << 16;
+    size_t           used  = 0;
+    while(true)
+    {
+        buffer.resize(used + CHUNK);
+        ssize_t n = read(fd, buffer.data() + used, CHUNK);
+        if(n < 0 && errno == EINTR)
+        {
+            continue;
+        }
+        if(n <= 0)
+        {
+            buffer.resize(used);
+            return n == 0;
+        }
+        used += n;
+    }
+}
+} // namespace lox
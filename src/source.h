@@ -0,0 +1,35 @@
+#ifndef SOURCE_H
+#define SOURCE_H
+
+#include <cstddef>
+#include <string>
+#include <string_view>
+
+namespace lox {
+// owns the bytes of a script: regular files are memory-mapped read-only,
+// anything that cannot be mapped (pipes, character devices) is read once
+// into an internal buffer. view() stays valid for the lifetime of the object
+class SourceBuffer
+{
+  public:
+    SourceBuffer() = default;
+    SourceBuffer(const SourceBuffer &)            = delete;
+    SourceBuffer &operator=(const SourceBuffer &) = delete;
+    SourceBuffer(SourceBuffer &&other) noexcept;
+    SourceBuffer &operator=(SourceBuffer &&other) noexcept;
+    ~SourceBuffer();
+
+    bool             load(const std::string &filename);
+    std::string_view view() const;
+
+  private:
+    void release();
+    bool read_all(int fd);
+
+    const char *mapped      = nullptr;
+    size_t      mapped_size = 0;
+    std::string buffer;
+};
+} // namespace lox
+
+#endif // SOURCE_H
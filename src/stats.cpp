@@ -0,0 +1,193 @@
+#include "stats.h"
+#include <algorithm>
+#include <atomic>
+#include <cstdio>
+#include <cstdlib>
+#include <iterator>
+#include <malloc.h>
+#include <new>
+#include <sys/resource.h>
+
+namespace lox {
+namespace {
+constexpr const char *PHASE_NAMES[] = {"read", "scan", "parse", "compile", "execute", "output"};
+static_assert(std::size(PHASE_NAMES) == static_cast<size_t>(Phase::COUNT));
+
+// ru_maxrss is reported in kilobytes on Linux
+long peak_rss_kib()
+{
+    rusage usage{};
+    return getrusage(RUSAGE_SELF, &usage) == 0 ? usage.ru_maxrss : 0;
+}
+
+void print_allocations(std::ostream &os, const char *name, const AllocationCounts &counts)
+{
+    char line[96];
+    std::snprintf(line, sizeof line, "  %-12s%12zu%16zu%16zu\n", name, counts.count, counts.bytes, counts.peak_live);
+    os << line;
+}
+
+#ifdef LOX_TRACK_ALLOCATIONS
+// one slot per phase plus one for allocations outside any phase. counters
+// are relaxed atomics: worker threads allocate too, and only totals matter
+struct PhaseCounters
+{
+    std::atomic<size_t> count{0};
+    std::atomic<size_t> bytes{0};
+    std::atomic<size_t> peak_live{0};
+};
+
+constexpr size_t PHASE_SLOTS = static_cast<size_t>(Phase::COUNT) + 1;
+
+PhaseCounters       counters[PHASE_SLOTS];
+std::atomic<size_t> live{0};
+thread_local Phase  current_phase = Phase::COUNT;
+
+// live bytes are tracked by usable size, which free() can recover without a
+// header in front of every block
+void *track_allocation(void *pointer, size_t size)
+{
+    if(!pointer) return nullptr;
+    PhaseCounters &phase = counters[static_cast<size_t>(current_phase)];
+    phase.count.fetch_add(1, std::memory_order_relaxed);
+    phase.bytes.fetch_add(size, std::memory_order_relaxed);
+    size_t usable = malloc_usable_size(pointer);
+    size_t now    = live.fetch_add(usable, std::memory_order_relaxed) + usable;
+    size_t peak   = phase.peak_live.load(std::memory_order_relaxed);
+    while(now > peak && !phase.peak_live.compare_exchange_weak(peak, now, std::memory_order_relaxed))
+    {
+    }
+    return pointer;
+}
+
+void track_free(void *pointer)
+{
+    if(!pointer) return;
+    live.fetch_sub(malloc_usable_size(pointer), std::memory_order_relaxed);
+    std::free(pointer);
+}
+
+void *allocate(size_t size)
+{
+    void *pointer = track_allocation(std::malloc(size ? size : 1), size);
+    if(!pointer) throw std::bad_alloc();
+    return pointer;
+}
+
+void *allocate_aligned(size_t size, std::align_val_t align)
+{
+    void *pointer = nullptr;
+    if(posix_memalign(&pointer, std::max(static_cast<size_t>(align), sizeof(void *)), size ? size : 1) != 0)
+    {
+        throw std::bad_alloc();
+    }
+    return track_allocation(pointer, size);
+}
+#endif
+} // namespace
+
+#ifdef LOX_TRACK_ALLOCATIONS
+Phase enter_allocation_phase(Phase phase)
+{
+    Phase previous = current_phase;
+    current_phase  = phase;
+    return previous;
+}
+
+AllocationCounts allocation_counts(Phase phase)
+{
+    const PhaseCounters &slot = counters[static_cast<size_t>(phase)];
+    return {slot.count.load(std::memory_order_relaxed), slot.bytes.load(std::memory_order_relaxed),
+            slot.peak_live.load(std::memory_order_relaxed)};
+}
+#else
+Phase enter_allocation_phase(Phase)
+{
+    return Phase::COUNT;
+}
+
+AllocationCounts allocation_counts(Phase)
+{
+    return {};
+}
+#endif
+
+AllocationCounts allocation_totals()
+{
+    AllocationCounts totals;
+    for(size_t i = 0; i <= static_cast<size_t>(Phase::COUNT); i++)
+    {
+        AllocationCounts counts = allocation_counts(static_cast<Phase>(i));
+        totals.count += counts.count;
+        totals.bytes += counts.bytes;
+        totals.peak_live = std::max(totals.peak_live, counts.peak_live);
+    }
+    return totals;
+}
+
+void Stats::report(std::ostream &os) const
+{
+    char line[64];
+    for(size_t i = 0; i < static_cast<size_t>(Phase::COUNT); i++)
+    {
+        double ms = std::chrono::duration<double, std::milli>(times[i]).count();
+        std::snprintf(line, sizeof line, "%-14s%12.3f ms\n", PHASE_NAMES[i], ms);
+        os << line;
+    }
+    std::snprintf(line, sizeof line, "%-14s%12zu\n", "tokens", tokens);
+    os << line;
+    std::snprintf(line, sizeof line, "%-14s%12zu\n", "nodes", nodes);
+    os << line;
+    std::snprintf(line, sizeof line, "%-14s%12zu\n", "statements", statements);
+    os << line;
+    std::snprintf(line, sizeof line, "%-14s%12ld KiB\n", "peak rss", peak_rss_kib());
+    os << line;
+    std::snprintf(line, sizeof line, "%-14s%12zu\n", "bytes written", bytes_written);
+    os << line;
+
+    if constexpr(TRACK_ALLOCATIONS)
+    {
+        std::snprintf(line, sizeof line, "%-14s%12s%16s%16s\n", "allocations", "count", "bytes", "peak live");
+        os << line;
+        for(size_t i = 0; i < static_cast<size_t>(Phase::COUNT); i++)
+        {
+            print_allocations(os, PHASE_NAMES[i], allocation_counts(static_cast<Phase>(i)));
+        }
+        print_allocations(os, "other", allocation_counts(Phase::COUNT));
+        print_allocations(os, "total", allocation_totals());
+    }
+}
+} // namespace lox
+
+#ifdef LOX_TRACK_ALLOCATIONS
+// the array forms and the nothrow forms forward to these in libstdc++
+void *operator new(size_t size)
+{
+    return lox::allocate(size);
+}
+
+void *operator new(size_t size, std::align_val_t align)
+{
+    return lox::allocate_aligned(size, align);
+}
+
+void operator delete(void *pointer) noexcept
+{
+    lox::track_free(pointer);
+}
+
+void operator delete(void *pointer, size_t) noexcept
+{
+    lox::track_free(pointer);
+}
+
+void operator delete(void *pointer, std::align_val_t) noexcept
+{
+    lox::track_free(pointer);
+}
+
+void operator delete(void *pointer, size_t, std::align_val_t) noexcept
+{
+    lox::track_free(pointer);
+}
+#endif
@@ -0,0 +1,126 @@
+#ifndef STATS_H
+#define STATS_H
+
+#include <array>
+#include <chrono>
+#include <cstddef>
+#include <iostream>
+
+namespace lox {
+enum class Phase
+{
+    READ,    // loading the source file and any cached program
+    SCAN,    // tokenize's loop of producing and formatting tokens
+    PARSE,   // building the AST, including the scanning it pulls in
+    COMPILE, // optimizing, resolving and compiling to bytecode
+    EXECUTE, // running the program, not counting writes to the descriptor
+    OUTPUT,  // formatting trees and writing buffered output
+    COUNT
+};
+
+// counters and per-phase wall times of one interpreter session. collection
+// is opt-in: components hold a Stats pointer that is null unless the user
+// asked for a report, so a disabled run only pays for the null checks
+class Stats
+{
+  public:
+    using Clock = std::chrono::steady_clock;
+
+    // adds `elapsed` to `phase`; time already recorded by phases nested inside
+    // it is expected to have been subtracted by the caller (see PhaseTimer)
+    void record(Phase phase, Clock::duration elapsed)
+    {
+        times[static_cast<size_t>(phase)] += elapsed;
+        recorded += elapsed;
+    }
+    // total time recorded across all phases
+    Clock::duration total() const
+    {
+        return recorded;
+    }
+    Clock::duration time(Phase phase) const
+    {
+        return times[static_cast<size_t>(phase)];
+    }
+
+    // writes the report, including the process's peak resident set size
+    void report(std::ostream &os) const;
+
+    size_t tokens        = 0; // not counting END_OF_FILE
+    size_t nodes         = 0; // AST nodes built by the parser
+    size_t statements    = 0; // top-level statements run to completion
+    size_t bytes_written = 0;
+
+  private:
+    std::array<Clock::duration, static_cast<size_t>(Phase::COUNT)> times{};
+    Clock::duration                                                recorded{};
+};
+
+#ifdef LOX_TRACK_ALLOCATIONS
+inline constexpr bool TRACK_ALLOCATIONS = true;
+#else
+inline constexpr bool TRACK_ALLOCATIONS = false;
+#endif
+
+// heap traffic charged to one phase. only counted in builds configured with
+// LOX_TRACK_ALLOCATIONS, which replace the global operator new and delete;
+// everything else reads zero
+struct AllocationCounts
+{
+    size_t count     = 0;
+    size_t bytes     = 0; // as requested, not counting allocator overhead
+    size_t peak_live = 0; // most bytes live at once while in the phase
+};
+
+// allocations on this thread are charged to `phase` from now on; returns the
+// phase charged so far. Phase::COUNT stands for "outside any phase"
+Phase            enter_allocation_phase(Phase phase);
+AllocationCounts allocation_counts(Phase phase);
+// summed over all phases, with the overall peak
+AllocationCounts allocation_totals();
+
+// charges the wall time of its scope to a phase of `stats`, if there is one.
+// timers nest: an inner timer's time is taken out of the enclosing one, so
+// the parser pulling tokens from the scanner splits cleanly into both phases.
+// with allocation tracking built in, its scope also sets the phase that
+// allocations are charged to, whether or not `stats` is null
+class PhaseTimer
+{
+  public:
+    PhaseTimer(Stats *stats, Phase phase) : stats(stats), phase(phase)
+    {
+#ifdef LOX_TRACK_ALLOCATIONS
+        previous = enter_allocation_phase(phase);
+#endif
+        if(stats)
+        {
+            nested = stats->total();
+            start  = Stats::Clock::now();
+        }
+    }
+    PhaseTimer(const PhaseTimer &)            = delete;
+    PhaseTimer &operator=(const PhaseTimer &) = delete;
+    ~PhaseTimer()
+    {
+        if(stats)
+        {
+            Stats::Clock::duration elapsed = Stats::Clock::now() - start;
+            stats->record(phase, elapsed - (stats->total() - nested));
+        }
+#ifdef LOX_TRACK_ALLOCATIONS
+        enter_allocation_phase(previous);
+#endif
+    }
+
+  private:
+    Stats                   *stats;
+    Phase                    phase;
+    Stats::Clock::time_point start;
+    Stats::Clock::duration   nested{};
+#ifdef LOX_TRACK_ALLOCATIONS
+    Phase previous;
+#endif
+};
+} // namespace lox
+
+#endif // STATS_H
@@ -0,0 +1,120 @@
+#include "thread_pool.h"
+#include <algorithm>
+
+namespace lox {
+ThreadPool::ThreadPool(unsigned threads)
+{
+    if(threads == 0)
+    {
+        threads = std::max(1u, std::thread::hardware_concurrency());
+    }
+    ranges.reset(new Range[threads]);
+    // thread 0 is whoever calls parallel_for
+    for(unsigned i = 1; i < threads; i++)
+    {
+        workers.emplace_back([this, i] { work(i); });
+    }
+}
+
+ThreadPool::~ThreadPool()
+{
+    {
+        std::lock_guard lock(mutex);
+        stopping = true;
+    }
+    wake.notify_all();
+    for(std::thread &worker: workers)
+    {
+        worker.join();
+    }
+}
+
+unsigned ThreadPool::size() const
+{
+    return static_cast<unsigned>(workers.size()) + 1;
+}
+
+void ThreadPool::parallel_for(size_t count, const std::function<void(size_t)> &body)
+{
+    {
+        std::lock_guard lock(mutex);
+        for(unsigned i = 0; i < size(); i++)
+        {
+            std::lock_guard range_lock(ranges[i].mutex);
+            ranges[i].begin = count * i / size();
+            ranges[i].end   = count * (i + 1) / size();
+        }
+        this->body = &body;
+        busy       = static_cast<unsigned>(workers.size());
+        generation++;
+    }
+    wake.notify_all();
+    run_items(0);
+
+    std::unique_lock lock(mutex);
+    finished.wait(lock, [this] { return busy == 0; });
+    this->body = nullptr;
+}
+
+void ThreadPool::work(unsigned self)
+{
+    unsigned long seen = 0;
+    for(;;)
+    {
+        {
+            std::unique_lock lock(mutex);
+            wake.wait(lock, [&] { return stopping || generation != seen; });
+            if(stopping) return;
+            seen = generation;
+        }
+        run_items(self);
+        std::lock_guard lock(mutex);
+        if(--busy == 0)
+        {
+            finished.notify_one();
+        }
+    }
+}
+
+void ThreadPool::run_items(unsigned self)
+{
+    size_t index;
+    while(take(self, index) || steal(self, index))
+    {
+        (*body)(index);
+    }
+}
+
+bool ThreadPool::take(unsigned self, size_t &index)
+{
+    Range          &own = ranges[self];
+    std::lock_guard lock(own.mutex);
+    if(own.begin == own.end) return false;
+    index = own.begin++;
+    return true;
+}
+
+// moves the back half of the first non-empty range after our own into ours
+// and claims its first index; fails once every range is empty
+bool ThreadPool::steal(unsigned self, size_t &index)
+{
+    for(unsigned offset = 1; offset < size(); offset++)
+    {
+        Range &victim = ranges[(self + offset) % size()];
+        size_t begin, end;
+        {
+            std::lock_guard lock(victim.mutex);
+            if(victim.begin == victim.end) continue;
+            begin      = victim.begin + (victim.end - victim.begin) / 2;
+            end        = victim.end;
+            victim.end = begin;
+        }
+        std::lock_guard lock(ranges[self].mutex);
+        index              = begin;
+        ranges[self].begin = begin + 1;
+        ranges[self].end   = end;
+        return true;
+    }
+    return false;
+}
+} // namespace lox
@@ -0,0 +1,59 @@
+#ifndef THREAD_POOL_H
+#define THREAD_POOL_H
+
+#include <condition_variable>
+#include <cstddef>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace lox {
+// fixed set of worker threads for data-parallel loops. every loop is split
+// into one contiguous range per thread; a thread works through its own range
+// from the front and, once it runs dry, steals the back half of another
+// thread's range, so uneven items balance out without a shared counter
+class ThreadPool
+{
+  public:
+    // 0 threads means one per hardware thread; the calling thread counts as
+    // one of them, so a pool of 1 starts no workers at all
+    explicit ThreadPool(unsigned threads = 0);
+    ThreadPool(const ThreadPool &)            = delete;
+    ThreadPool &operator=(const ThreadPool &) = delete;
+    ~ThreadPool();
+
+    // threads taking part in a loop, including the caller
+    unsigned size() const;
+    // runs body(i) for every i in [0, count) and returns once all are done.
+    // `body` must not throw
+    void     parallel_for(size_t count, const std::function<void(size_t)> &body);
+
+  private:
+    // the indices a thread has yet to run
+    struct Range
+    {
+        std::mutex mutex;
+        size_t     begin = 0;
+        size_t     end   = 0;
+    };
+
+    void work(unsigned self);
+    void run_items(unsigned self);
+    bool take(unsigned self, size_t &index);
+    bool steal(unsigned self, size_t &index);
+
+    std::vector<std::thread>           workers;
+    std::mutex                         mutex;
+    std::condition_variable            wake;
+    std::condition_variable            finished;
+    std::unique_ptr<Range[]>           ranges;
+    const std::function<void(size_t)> *body       = nullptr;
+    unsigned                           busy       = 0;
+    unsigned long                      generation = 0;
+    bool                               stopping   = false;
+};
+} // namespace lox
+
+#endif // THREAD_POOL_H
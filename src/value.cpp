@@ -0,0 +1,120 @@
+#include "value.h"
+#include <charconv>
+#include <ostream>
+
+namespace lox {
+bool operator==(Value a, Value b)
+{
+    if(a.is_number() && b.is_number())
+    {
+        return a.as_number() == b.as_number();
+    }
+    // strings are interned, so identical bits also mean identical contents
+    return a.bits == b.bits;
+}
+
+size_t format_number(double value, char *buffer)
+{
+    auto [end, ec] = std::to_chars(buffer, buffer + NUMBER_CHARS, value, std::chars_format::general, 6);
+    return ec == std::errc() ? end - buffer : 0;
+}
+
+std::string to_string(Value value)
+{
+    if(value.is_number())
+    {
+        char buffer[NUMBER_CHARS];
+        return std::string(buffer, format_number(value.as_number(), buffer));
+    }
+    if(value.is_bool())
+    {
+        return value.as_bool() ? "true" : "false";
+    }
+    if(value.is_string())
+    {
+        return std::string(value.as_string()->view());
+    }
+    return "nil";
+}
+
+std::ostream &operator<<(std::ostream &os, Value value)
+{
+    if(value.is_number())
+    {
+        char buffer[NUMBER_CHARS];
+        return os.write(buffer, format_number(value.as_number(), buffer));
+    }
+    if(value.is_bool())
+    {
+        return os << (value.as_bool() ? "true" : "false");
+    }
+    if(value.is_string())
+    {
+        return os << value.as_string()->view();
+    }
+    return os << "nil";
+}
+
+uint32_t hash_string(std::string_view chars)
+{
+    // FNV-1a
+    uint32_t hash = 2166136261u;
+    for(unsigned char c: chars)
+    {
+        hash ^= c;
+        hash *= 16777619u;
+    }
+    return hash;
+}
+
+Heap::Heap() : table(INITIAL_CAPACITY, nullptr) {}
+
+const ObjString *Heap::intern(std::string_view chars)
+{
+    uint32_t hash = hash_string(chars);
+    size_t   mask = table.size() - 1;
+    size_t   slot = hash & mask;
+    while(const ObjString *entry = table[slot])
+    {
+        if(entry->hash == hash && entry->view() == chars)
+        {
+            return entry;
+        }
+        slot = (slot + 1) & mask;
+    }
+
+    char *copy = static_cast<char *>(arena.allocate(chars.size(), 1));
+    std::memcpy(copy, chars.data(), chars.size());
+    const ObjString *string = arena.make<ObjString>(ObjString{copy, chars.size(), hash});
+    table[slot]             = string;
+    if(++count * 4 > table.size() * 3)
+    {
+        grow();
+    }
+    return string;
+}
+
+const ObjString *Heap::concatenate(const ObjString *a, const ObjString *b)
+{
+    scratch.assign(a->chars, a->length);
+    scratch.append(b->chars, b->length);
+    return intern(scratch);
+}
+
+void Heap::grow()
+{
+    std::vector<const ObjString *> old(table.size() * 2, nullptr);
+    old.swap(table);
+    size_t mask = table.size() - 1;
+    for(const ObjString *entry: old)
+    {
+        if(!entry) continue;
+        size_t slot = entry->hash & mask;
+        while(table[slot])
+        {
+            slot = (slot + 1) & mask;
+        }
+        table[slot] = entry;
+    }
+}
+} // namespace lox
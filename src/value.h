@@ -0,0 +1,166 @@
+#ifndef VALUE_H
+#define VALUE_H
+
+#include "arena.h"
+#include <cstdint>
+#include <cstring>
+#include <iosfwd>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+namespace lox {
+// immutable, interned string object. a Heap hands out exactly one ObjString
+// per distinct character sequence, so two strings are equal iff their
+// pointers are, and the hash is computed once when the string is interned
+struct ObjString
+{
+    const char *chars;
+    size_t      length;
+    uint32_t    hash;
+
+    std::string_view view() const
+    {
+        return std::string_view(chars, length);
+    }
+};
+
+// 8-byte NaN-boxed value: any double that is not one of our quiet NaN
+// patterns is a number; nil, false and true are fixed quiet NaNs, and
+// object references set the sign bit and keep the pointer in the low 48 bits
+class Value
+{
+  public:
+    Value() : bits(QNAN | TAG_NIL) {}
+
+    static Value number(double value)
+    {
+        Value result;
+        std::memcpy(&result.bits, &value, sizeof(double));
+        return result;
+    }
+    static Value boolean(bool value)
+    {
+        return from_bits(QNAN | (value ? TAG_TRUE : TAG_FALSE));
+    }
+    static Value nil()
+    {
+        return Value();
+    }
+    static Value string(const ObjString *string)
+    {
+        return from_bits(SIGN_BIT | QNAN | reinterpret_cast<uintptr_t>(string));
+    }
+
+    bool is_number() const
+    {
+        return (bits & QNAN) != QNAN;
+    }
+    bool is_bool() const
+    {
+        return (bits | 1) == (QNAN | TAG_TRUE);
+    }
+    bool is_nil() const
+    {
+        return bits == (QNAN | TAG_NIL);
+    }
+    bool is_string() const
+    {
+        return (bits & (SIGN_BIT | QNAN)) == (SIGN_BIT | QNAN);
+    }
+
+    double as_number() const
+    {
+        double value;
+        std::memcpy(&value, &bits, sizeof(double));
+        return value;
+    }
+    bool as_bool() const
+    {
+        return bits == (QNAN | TAG_TRUE);
+    }
+    const ObjString *as_string() const
+    {
+        return reinterpret_cast<const ObjString *>(static_cast<uintptr_t>(bits & ~(SIGN_BIT | QNAN)));
+    }
+
+    bool is_falsey() const
+    {
+        return is_nil() || (is_bool() && !as_bool());
+    }
+
+    friend bool operator==(Value a, Value b);
+
+  private:
+    static Value from_bits(uint64_t bits)
+    {
+        Value result;
+        result.bits = bits;
+        return result;
+    }
+
+    static constexpr uint64_t SIGN_BIT  = 0x8000000000000000;
+    static constexpr uint64_t QNAN      = 0x7ffc000000000000;
+    static constexpr uint64_t TAG_NIL   = 1;
+    static constexpr uint64_t TAG_FALSE = 2;
+    static constexpr uint64_t TAG_TRUE  = 3;
+
+    uint64_t bits;
+};
+
+static_assert(sizeof(Value) == 8);
+
+bool        operator==(Value a, Value b);
+std::string to_string(Value value);
+// writes the printed form of `value` without building a string
+std::ostream &operator<<(std::ostream &os, Value value);
+
+// formats a number the way print shows it (like printf's %g) into `buffer`,
+// which must hold NUMBER_CHARS characters; returns the length
+constexpr size_t NUMBER_CHARS = 32;
+size_t           format_number(double value, char *buffer);
+
+struct ObjStringHash
+{
+    size_t operator()(const ObjString *string) const
+    {
+        return string->hash;
+    }
+};
+
+// map keyed by interned strings: lookups reuse the precomputed hash and
+// compare keys by pointer
+template <typename T> using SymbolMap = std::unordered_map<const ObjString *, T, ObjStringHash>;
+
+uint32_t hash_string(std::string_view chars);
+
+// owns and interns every string of a program: identifiers and literals seen
+// by the parser as well as strings created at runtime. everything is released
+// together when the heap goes away
+class Heap
+{
+  public:
+    Heap();
+    Heap(const Heap &)            = delete;
+    Heap &operator=(const Heap &) = delete;
+
+    // returns the unique string with these characters, copying them into the
+    // heap the first time they are seen
+    const ObjString *intern(std::string_view chars);
+    const ObjString *concatenate(const ObjString *a, const ObjString *b);
+
+  private:
+    void grow();
+
+    static constexpr size_t INITIAL_CAPACITY = 64;
+
+    // open-addressed table of interned strings, capacity a power of two
+    std::vector<const ObjString *> table;
+    size_t                         count = 0;
+    std::string                    scratch;
+    Arena                          arena;
+};
+} // namespace lox
+
+#endif // VALUE_H
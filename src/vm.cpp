@@ -0,0 +1,153 @@
+#include "vm.h"
+
+namespace lox {
+InterpretResult VM::run(const Chunk &chunk)
+{
+    const uint8_t *ip = chunk.code.data();
+    // start of the instruction being executed, for error reports
+    const uint8_t *instruction;
+    auto read_operand = [&]() {
+        size_t index = chunk.read_operand(ip - chunk.code.data());
+        ip += Chunk::OPERAND_SIZE;
+        return index;
+    };
+
+#define BINARY_OP(make, op)                                                                            \
+    do                                                                                                 \
+    {                                                                                                  \
+        if(!numeric_operands()) return runtime_error(chunk, instruction, "Operands must be numbers."); \
+        double right = pop().as_number();                                                              \
+        double left  = stack.back().as_number();                                                       \
+        stack.back() = Value::make(left op right);                                                     \
+    } while(false)
+
+    globals.reserve(chunk.globals.size());
+    for(;;)
+    {
+        instruction = ip;
+        switch(*ip++)
+        {
+        case OP_CONSTANT:
+            stack.push_back(chunk.constants[read_operand()]);
+            break;
+        case OP_NIL:
+            stack.push_back(Value::nil());
+            break;
+        case OP_TRUE:
+            stack.push_back(Value::boolean(true));
+            break;
+        case OP_FALSE:
+            stack.push_back(Value::boolean(false));
+            break;
+        case OP_POP:
+            stack.pop_back();
+            break;
+        case OP_GET_GLOBAL:
+        {
+            int slot = static_cast<int>(read_operand());
+            if(!globals.is_defined(slot))
+            {
+                return undefined_variable(chunk, instruction, slot);
+            }
+            stack.push_back(globals.get(slot));
+            break;
+        }
+        case OP_DEFINE_GLOBAL:
+            globals.define(static_cast<int>(read_operand()), pop());
+            break;
+        case OP_SET_GLOBAL:
+        {
+            int slot = static_cast<int>(read_operand());
+            if(!globals.is_defined(slot))
+            {
+                return undefined_variable(chunk, instruction, slot);
+            }
+            globals.set(slot, stack.back());
+            break;
+        }
+        case OP_EQUAL:
+        {
+            Value right  = pop();
+            stack.back() = Value::boolean(stack.back() == right);
+            break;
+        }
+        case OP_NOT_EQUAL:
+        {
+            Value right  = pop();
+            stack.back() = Value::boolean(!(stack.back() == right));
+            break;
+        }
+        case OP_GREATER:       BINARY_OP(boolean, >); break;
+        case OP_GREATER_EQUAL: BINARY_OP(boolean, >=); break;
+        case OP_LESS:          BINARY_OP(boolean, <); break;
+        case OP_LESS_EQUAL:    BINARY_OP(boolean, <=); break;
+        case OP_SUBTRACT:      BINARY_OP(number, -); break;
+        case OP_MULTIPLY:      BINARY_OP(number, *); break;
+        case OP_DIVIDE:        BINARY_OP(number, /); break;
+        case OP_ADD:
+        {
+            if(numeric_operands())
+            {
+                double right = pop().as_number();
+                stack.back() = Value::number(stack.back().as_number() + right);
+            }
+            else if(stack.back().is_string() && stack[stack.size() - 2].is_string())
+            {
+                const ObjString *right = pop().as_string();
+                stack.back()           = Value::string(heap.concatenate(stack.back().as_string(), right));
+            }
+            else
+            {
+                return runtime_error(chunk, instruction, "Operands must be two numbers or two strings.");
+            }
+            break;
+        }
+        case OP_NOT:
+            stack.back() = Value::boolean(stack.back().is_falsey());
+            break;
+        case OP_NEGATE:
+            if(!stack.back().is_number())
+            {
+                return runtime_error(chunk, instruction, "Operand must be a number.");
+            }
+            stack.back() = Value::number(-stack.back().as_number());
+            break;
+        case OP_PRINT:
+            out << pop() << '\n';
+            break;
+        case OP_RETURN:
+            last_result = stack.empty() ? Value::nil() : stack.back();
+            stack.clear();
+            return INTERPRET_OK;
+        default:
+            return runtime_error(chunk, instruction, "Unknown opcode.");
+        }
+    }
+#undef BINARY_OP
+}
+
+Value VM::pop()
+{
+    Value value = stack.back();
+    stack.pop_back();
+    return value;
+}
+
+bool VM::numeric_operands() const
+{
+    return stack.back().is_number() && stack[stack.size() - 2].is_number();
+}
+
+InterpretResult VM::undefined_variable(const Chunk &chunk, const uint8_t *instruction, int slot)
+{
+    return runtime_error(chunk, instruction, "Undefined variable '" + std::string(chunk.globals[slot]->view()) + "'.");
+}
+
+InterpretResult VM::runtime_error(const Chunk &chunk, const uint8_t *instruction, const std::string &message)
+{
+    size_t offset = failed_offset = instruction - chunk.code.data();
+    diagnostics.runtime_error(chunk.get_line(offset), message);
+    stack.clear();
+    return INTERPRET_RUNTIME_ERROR;
+}
+} // namespace lox
@@ -0,0 +1,65 @@
+#ifndef VM_H
+#define VM_H
+
+#include "chunk.h"
+#include "diagnostics.h"
+#include "resolver.h"
+#include <iostream>
+#include <string>
+#include <vector>
+
+namespace lox {
+enum InterpretResult
+{
+    INTERPRET_OK,
+    INTERPRET_RUNTIME_ERROR
+};
+
+// stack machine executing the bytecode produced by the Compiler
+class VM
+{
+  public:
+    // strings created at runtime are allocated in `heap`; runtime errors are
+    // reported to `diagnostics` and end the run with INTERPRET_RUNTIME_ERROR
+    VM(Heap &heap, Diagnostics &diagnostics, std::ostream &out = std::cout)
+        : globals(own_globals), heap(heap), diagnostics(diagnostics), out(out)
+    {
+    }
+    // runs against `globals`, which outlives the VM, so variables carry over
+    // between chunks compiled with the same Resolver
+    VM(Heap &heap, Diagnostics &diagnostics, Globals &globals, std::ostream &out = std::cout)
+        : globals(globals), heap(heap), diagnostics(diagnostics), out(out)
+    {
+    }
+    InterpretResult run(const Chunk &chunk);
+    // the value left on the stack when the last run returned, e.g. by an
+    // expression compiled without printing; nil if there was none
+    Value           result() const
+    {
+        return last_result;
+    }
+    // code offset of the instruction that raised the last runtime error
+    size_t          error_offset() const
+    {
+        return failed_offset;
+    }
+
+  private:
+    Value           pop();
+    bool            numeric_operands() const;
+    // `instruction` points at the opcode of the failing instruction
+    InterpretResult undefined_variable(const Chunk &chunk, const uint8_t *instruction, int slot);
+    InterpretResult runtime_error(const Chunk &chunk, const uint8_t *instruction, const std::string &message);
+
+    std::vector<Value> stack;
+    Globals            own_globals;
+    Globals           &globals;
+    Heap              &heap;
+    Diagnostics       &diagnostics;
+    std::ostream      &out;
+    size_t             failed_offset = 0;
+    Value              last_result   = Value::nil();
+};
+} // namespace lox
+
+#endif // VM_H
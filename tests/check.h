@@ -0,0 +1,35 @@
+#ifndef CHECK_H
+#define CHECK_H
+
+#include <iostream>
+
+// minimal assertions for the unit tests: a failed CHECK reports itself and
+// makes CHECK_RESULT() nonzero, so every check of a test runs
+inline int check_failures = 0;
+
+#define CHECK(condition)                                                                 \
+    do                                                                                   \
+    {                                                                                    \
+        if(!(condition))                                                                 \
+        {                                                                                \
+            std::cerr << __FILE__ << ':' << __LINE__ << ": CHECK(" #condition ") failed\n"; \
+            check_failures++;                                                            \
+        }                                                                                \
+    } while(0)
+
+#define CHECK_EQ(actual, expected)                                                                          \
+    do                                                                                                      \
+    {                                                                                                       \
+        auto check_actual   = (actual);                                                                     \
+        auto check_expected = (expected);                                                                   \
+        if(!(check_actual == check_expected))                                                               \
+        {                                                                                                   \
+            std::cerr << __FILE__ << ':' << __LINE__ << ": " #actual " is " << check_actual << ", expected " \
+                      << check_expected << '\n';                                                            \
+            check_failures++;                                                                               \
+        }                                                                                                   \
+    } while(0)
+
+#define CHECK_RESULT() (check_failures == 0 ? 0 : 1)
+
+#endif // CHECK_H
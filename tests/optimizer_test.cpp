@@ -0,0 +1,46 @@
+#include "check.h"
+#include "optimizer.h"
+#include "scanner.h"
+#include <sstream>
+#include <string>
+
+namespace {
+// what `parse --optimized` prints for `source`
+std::string optimized_form(const std::string &source)
+{
+    std::ostringstream errors;
+    lox::Diagnostics   diagnostics(errors);
+    lox::Arena         arena;
+    lox::Heap          heap;
+    lox::Scanner       scanner(source, diagnostics);
+    lox::Parser        parser(scanner, arena, heap, diagnostics);
+    lox::Expression   *expr = parser.parse();
+    if(!expr || diagnostics.had_error())
+    {
+        return "error: " + errors.str();
+    }
+    return lox::Optimizer(arena, heap).optimize(expr)->form_string();
+}
+} // namespace
+
+int main()
+{
+    // finite results are folded
+    CHECK_EQ(optimized_form("1 + 2 * 3"), "7.0");
+    CHECK_EQ(optimized_form("1 / 4"), "0.25");
+    CHECK_EQ(optimized_form("\"a\" + \"b\""), "ab");
+    CHECK_EQ(optimized_form("-(2)"), "-2.0");
+
+    // inf and nan have no literal form, so those operations stay
+    CHECK_EQ(optimized_form("10 / 0"), "(/ 10.0 0.0)");
+    CHECK_EQ(optimized_form("-(1 / 0)"), "(- (/ 1.0 0.0))");
+    CHECK_EQ(optimized_form("0 / 0"), "(/ 0.0 0.0)");
+
+    // large values print their shortest digits, not the double's expansion
+    CHECK_EQ(optimized_form("1000000000000 * 1000000000000"), "1000000000000000000000000.0");
+    CHECK_EQ(optimized_form("1000000000000000000000000"), "1000000000000000000000000.0");
+    CHECK_EQ(optimized_form("0.001"), "0.001");
+    CHECK_EQ(optimized_form("1.50"), "1.5");
+    CHECK_EQ(optimized_form("1 / 3"), "0.3333333333333333");
+    return CHECK_RESULT();
+}
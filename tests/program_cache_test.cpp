@@ -0,0 +1,113 @@
+#include "check.h"
+#include "program_cache.h"
+#include "session.h"
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <sstream>
+#include <string>
+
+namespace {
+// where the 64-bit key sits in an entry's header, after magic and format
+constexpr size_t KEY_OFFSET = 8;
+constexpr size_t KEY_SIZE   = 8;
+
+std::string read_file(const std::string &path)
+{
+    std::ifstream      in(path, std::ios::binary);
+    std::ostringstream contents;
+    contents << in.rdbuf();
+    return contents.str();
+}
+
+void write_file(const std::string &path, const std::string &contents)
+{
+    std::ofstream(path, std::ios::binary) << contents;
+}
+
+// the one cache entry in `directory`; other files must not end in .loxc
+std::string only_entry(const std::string &directory)
+{
+    std::string entry;
+    for(const auto &file: std::filesystem::directory_iterator(directory))
+    {
+        if(file.path().extension() == ".loxc")
+        {
+            CHECK(entry.empty());
+            entry = file.path().string();
+        }
+    }
+    return entry;
+}
+
+// runs `source` on the VM with `cache` and returns what it printed
+std::string run_cached(const lox::ProgramCache &cache, const std::string &source)
+{
+    std::ostringstream out;
+    lox::Session       session(lox::Engine::VM);
+    session.set_output(out);
+    session.set_cache(&cache);
+    if(session.load(source))
+    {
+        session.run();
+    }
+    return out.str();
+}
+} // namespace
+
+int main()
+{
+    char directory[] = "/tmp/lox-cache-test-XXXXXX";
+    if(!::mkdtemp(directory))
+    {
+        return 1;
+    }
+    lox::ProgramCache cache(directory);
+
+    // a program is stored on the first run and loaded on the second
+    CHECK_EQ(run_cached(cache, "var a = \"x\"; print a + \"y\";"), "xy\n");
+    lox::Chunk chunk;
+    lox::Heap  heap;
+    CHECK(cache.load("var a = \"x\"; print a + \"y\";", chunk, heap));
+    CHECK_EQ(run_cached(cache, "var a = \"x\"; print a + \"y\";"), "xy\n");
+    std::filesystem::remove(only_entry(directory));
+
+    // an entry whose key matches but whose source differs is a miss: give
+    // the entry of one program the file name and key of another of the same
+    // length, as a hash collision would
+    CHECK_EQ(run_cached(cache, "print 2;//eszy0k"), "2\n");
+    std::string second = only_entry(directory);
+    std::filesystem::rename(second, std::string(directory) + "/second");
+    CHECK_EQ(run_cached(cache, "print 1;//eszyci"), "1\n");
+    std::string first  = only_entry(directory);
+    std::string forged = read_file(first);
+    std::string key    = read_file(std::string(directory) + "/second").substr(KEY_OFFSET, KEY_SIZE);
+    forged.replace(KEY_OFFSET, KEY_SIZE, key);
+    write_file(second, forged);
+    CHECK_EQ(run_cached(cache, "print 2;//eszy0k"), "2\n");
+    CHECK_EQ(run_cached(cache, "print 1;//eszyci"), "1\n");
+
+    // a well-formed entry whose code holds a byte that is no opcode, or an
+    // operand past the constant pool, is a miss, and the session compiles
+    // the source itself
+    lox::Chunk corrupt;
+    corrupt.write(0xff, 1);
+    corrupt.write(lox::OP_RETURN, 1);
+    CHECK(cache.store("print 5;", corrupt));
+    lox::Chunk bad_opcode;
+    CHECK(!cache.load("print 5;", bad_opcode, heap));
+    CHECK_EQ(run_cached(cache, "print 5;"), "5\n");
+
+    lox::Chunk out_of_range;
+    out_of_range.write(lox::OP_CONSTANT, 1);
+    out_of_range.write_operand(7, 1);
+    out_of_range.write(lox::OP_PRINT, 1);
+    out_of_range.write(lox::OP_RETURN, 1);
+    CHECK(cache.store("print 6;", out_of_range));
+    lox::Chunk bad_operand;
+    CHECK(!cache.load("print 6;", bad_operand, heap));
+    CHECK_EQ(run_cached(cache, "print 6;"), "6\n");
+
+    std::filesystem::remove_all(directory);
+    return CHECK_RESULT();
+}
@@ -0,0 +1,34 @@
+#include "check.h"
+#include "session.h"
+#include <sstream>
+
+int main()
+{
+    for(lox::Engine engine: {lox::Engine::TREE, lox::Engine::VM})
+    {
+        std::ostringstream out;
+        lox::Session       session(engine);
+        session.set_output(out);
+
+        // nothing loaded yet
+        CHECK(!session.run());
+        CHECK_EQ(session.status(), 1);
+
+        // a program with a syntax error does not run, and run() says so
+        CHECK(!session.load("print (1;"));
+        CHECK_EQ(session.status(), 65);
+        CHECK(!session.run());
+        CHECK_EQ(session.status(), 65);
+
+        CHECK(session.load("var a = 2; print a * 3;"));
+        CHECK(session.run());
+        CHECK_EQ(session.status(), 0);
+        CHECK_EQ(out.str(), "6\n");
+
+        // a failed evaluate() leaves the loaded program runnable
+        CHECK(!session.evaluate("a +"));
+        CHECK(session.run());
+        CHECK_EQ(out.str(), "6\n6\n");
+    }
+    return CHECK_RESULT();
+}
@@ -0,0 +1,42 @@
+#include "check.h"
+#include "vm.h"
+#include <sstream>
+
+int main()
+{
+    lox::Heap heap;
+
+    // an error in an instruction with an operand is placed at its opcode
+    {
+        lox::Chunk chunk;
+        chunk.write(lox::OP_NIL, 1);
+        chunk.write(lox::OP_POP, 1);
+        chunk.write(lox::OP_GET_GLOBAL, 2);
+        chunk.write_operand(0, 2);
+        chunk.write(lox::OP_RETURN, 2);
+        chunk.globals.push_back(heap.intern("missing"));
+
+        std::ostringstream errors;
+        lox::Diagnostics   diagnostics(errors);
+        lox::VM            vm(heap, diagnostics);
+        CHECK_EQ(vm.run(chunk), lox::INTERPRET_RUNTIME_ERROR);
+        CHECK_EQ(vm.error_offset(), size_t(2));
+        CHECK_EQ(errors.str(), "Undefined variable 'missing'.\n[line 2]\n");
+    }
+
+    // a byte that is no opcode stops the run instead of being skipped
+    {
+        lox::Chunk chunk;
+        chunk.write(lox::OP_NIL, 1);
+        chunk.write(0xff, 3);
+        chunk.write(lox::OP_RETURN, 3);
+
+        std::ostringstream errors;
+        lox::Diagnostics   diagnostics(errors);
+        lox::VM            vm(heap, diagnostics);
+        CHECK_EQ(vm.run(chunk), lox::INTERPRET_RUNTIME_ERROR);
+        CHECK_EQ(vm.error_offset(), size_t(1));
+        CHECK_EQ(errors.str(), "Unknown opcode.\n[line 3]\n");
+    }
+    return CHECK_RESULT();
+}